@@ -0,0 +1,23 @@
+// FILE: boot_trace.h
+
+#ifndef BOOT_TRACE_H
+#define BOOT_TRACE_H
+
+#include "config.h"
+
+// Boot timeline: each phase marks its completion with a timestamp (µs since the app started)
+// into a fixed ring. Safe from any task on either core; nothing is allocated.
+
+const uint8_t BOOT_TRACE_CAPACITY = 32; // Oldest marks are overwritten once full
+
+struct BootTraceEvent {
+    const char *phase; // Must be a string literal
+    uint32_t at_us;
+};
+
+void bootTraceMark(const char *phase);
+uint8_t bootTraceSnapshot(BootTraceEvent *events, uint8_t max_events); // Oldest first
+const char *bootTraceResetReason();
+void bootTracePrint();
+
+#endif // BOOT_TRACE_H
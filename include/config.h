@@ -27,6 +27,16 @@ const uint8_t EXTERNAL_INTERRUPT_PIN = 27;
 
 // ─────────────── CONSTANTS ───────────────
 const uint8_t SCHEDULE_SLOT_COUNT = 9;
+const uint8_t PUBLISH_PERIOD_DEFAULT_S = 30; // Overridden by the "pub" NVS key
+const uint8_t BATCH_SAMPLES_DEFAULT = 0;      // Batching off; overridden by the "bsz" NVS key
+const uint8_t BATCH_MAX_AGE_DEFAULT_S = 60;   // "bag"
+
+// Protection thresholds (trip / re-arm), checked on every acquisition sample
+const float OVER_VOLTAGE_TRIP_V = 13.9;     // Stop charging
+const float OVER_VOLTAGE_RELEASE_V = 13.3;
+const float OVER_TEMP_TRIP_C = 65.0;        // Derate charging to THERMAL_DERATE_CURRENT_A
+const float OVER_TEMP_RELEASE_C = 60.0;
+const float THERMAL_DERATE_CURRENT_A = 2.5;
 
 // ─────────────── DATA STRUCTURES ───────────────
 struct batteryDataPack
@@ -70,6 +80,17 @@ struct timeDataPack
     uint8_t second;
 };
 
+// The energy globals (New_Wh ... current_energy_E) as they were when a sample was taken
+struct energyDataPack
+{
+    float new_wh;
+    float new_wh_e;
+    float full_wh;
+    float full_wh_e;
+    float current_energy;
+    float current_energy_e;
+};
+
 struct chargingProfilePack
 {
     int profile_number;
@@ -118,10 +139,6 @@ struct MqttConfig
 };
 
 // ─────────────── GLOBAL STATE VARIABLES (EXTERN) ───────────────
-extern batteryDataPack battery_data;
-extern solarDataPack solar_data;
-extern loadDataPack load_data;
-extern timeDataPack time_data;
 extern chargingProfilePack charge_profile;
 extern deviceSettingPack device_setting;
 extern loadScheduleSettingPack load_schedule[SCHEDULE_SLOT_COUNT];
@@ -132,8 +149,6 @@ extern int loaded_tud;
 extern int loaded_pgr;
 extern bool integrated;
 extern volatile bool upload_mode;
-extern volatile bool taskDone;
-extern volatile uint8_t s;
 extern volatile int TimeStartNewCurrent;
 extern volatile bool NewCurrent;
 
@@ -4,13 +4,26 @@
 #define CONNECTIVITY_OTA_H
 
 #include "config.h"
+#include "telemetry_codec.h"
 
 esp_err_t setupWiFi(wifiConfig wifi_parameter);
 esp_err_t setupMQTT(MqttConfig mqtt_parameter);
 void keepWiFiMqttAlive(void *parameter);
+bool mqttLinkUp(); // WiFi associated and the MQTT session open, as last seen by keepWiFiMqttAlive()
 
 // --- CORRECTED FUNCTION SIGNATURE ---
-esp_err_t publishData(const loadDataPack &load_data, const solarDataPack &solar_data, const batteryDataPack &battery_data, const timeDataPack &time_data, const char *publish_topic);
+// replayed = sample from the outbox, tagged "rp". Messages carry telemetry only; diagnostics go
+// to <topic>/diag once a minute while live samples are being published. Live keyed messages may
+// carry only the changed fields; see telemetry_deadband.h.
+esp_err_t publishData(const TelemetrySnapshot &snapshot, const char *publish_topic, bool replayed = false);
+
+// Several samples in one message, column by column; see publishBatch() for the layout
+esp_err_t publishBatch(const TelemetrySnapshot *samples, uint8_t count, const char *publish_topic);
+
+esp_err_t publishBootTrace(const char *publish_topic);
+
+void setWireFormat(WireFormat format);
+WireFormat wireFormat();
 
 void elegantTask(void *parameter);
 
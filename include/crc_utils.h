@@ -0,0 +1,22 @@
+// FILE: crc_utils.h
+
+#ifndef CRC_UTILS_H
+#define CRC_UTILS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Table-driven CRC engines. Both tables are generated at compile time and the *Update()
+// functions can be fed a message in any number of chunks.
+
+// CRC-16/MODBUS: poly 0xA001 (reflected 0x8005), init 0xFFFF, no final XOR.
+const uint16_t CRC16_MODBUS_INIT = 0xFFFF;
+uint16_t crc16ModbusUpdate(uint16_t crc, const uint8_t *data, size_t length);
+uint16_t crc16Modbus(const uint8_t *data, size_t length);
+
+// CRC-32 (IEEE 802.3): poly 0xEDB88320 (reflected), init/final XOR 0xFFFFFFFF.
+// crc32Update() takes and returns finished CRC values, so crc32Update(0, ...) == crc32(...).
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t length);
+uint32_t crc32(const uint8_t *data, size_t length);
+
+#endif // CRC_UTILS_H
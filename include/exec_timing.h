@@ -0,0 +1,54 @@
+// FILE: exec_timing.h
+
+#ifndef EXEC_TIMING_H
+#define EXEC_TIMING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_timer.h"
+
+// Execution-time statistics for any code path, measured with esp_timer (1 us resolution).
+// Declare an ExecTimingStats per path and put an ExecTimer at the top of the scope to measure:
+//
+//     static ExecTimingStats publish_timing = {"publish", 0, 500000};
+//     { ExecTimer timer(publish_timing); ... }
+
+const uint8_t EXEC_JITTER_BUCKETS = 7;
+
+// Upper bound (ms) of each start-jitter bucket; the last bucket is open-ended
+const uint16_t EXEC_JITTER_BUCKET_MS[EXEC_JITTER_BUCKETS - 1] = {1, 5, 20, 100, 500, 1000};
+
+struct ExecTimingStats {
+    const char *name;
+    uint32_t period_us;   // Expected start-to-start interval, 0 = not periodic (no jitter tracking)
+    uint32_t deadline_us; // Budget per run (from release when one is given), 0 = no deadline
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t deadline_misses;
+    uint32_t jitter_histogram[EXEC_JITTER_BUCKETS];
+    int64_t last_start_us;
+};
+
+void execTimingRecord(ExecTimingStats &stats, int64_t start_us, int64_t end_us);
+// For released (scheduled) work: jitter is start - release and the deadline counts from release
+void execTimingRecordRelease(ExecTimingStats &stats, int64_t release_us, int64_t start_us, int64_t end_us);
+void execTimingSnapshot(const ExecTimingStats &stats, ExecTimingStats *copy);
+uint32_t execTimingMeanUs(const ExecTimingStats &stats);
+void execTimingPrint(const ExecTimingStats *const *stats, size_t count);
+
+class ExecTimer {
+public:
+    explicit ExecTimer(ExecTimingStats &timing) : stats(timing), start_us(esp_timer_get_time()) {}
+    ~ExecTimer() { execTimingRecord(stats, start_us, esp_timer_get_time()); }
+
+private:
+    ExecTimer(const ExecTimer &);
+    ExecTimer &operator=(const ExecTimer &);
+
+    ExecTimingStats &stats;
+    const int64_t start_us;
+};
+
+#endif // EXEC_TIMING_H
@@ -5,30 +5,50 @@
 
 #include "config.h"
 
+// ─────────────── BUS REQUESTS ───────────────
+// setupSrne() starts a task that owns the SRNE UART and serves these requests in order,
+// always draining CONTROL requests before TELEMETRY ones. Every blocking HAL call below is built on top of it.
+enum class SrneOp : uint8_t { READ, WRITE_SINGLE, WRITE_MULTI };
+enum class SrnePriority : uint8_t { TELEMETRY, CONTROL };
+
+typedef void (*SrneCompletionCallback)(esp_err_t result, void *context);
+
+struct SrneRequest
+{
+    SrneOp op;
+    uint16_t start_address;
+    uint16_t count;
+    uint16_t *values;               // READ: destination, WRITE: source. Must stay valid until completion.
+    uint8_t max_retry;
+    uint16_t retry_interval_ms;
+    SrneCompletionCallback callback; // Optional, runs on the bus task; must not make blocking HAL calls
+    void *context;
+    TaskHandle_t notify_task;        // Optional, notified with the esp_err_t result as the value
+};
+
 esp_err_t setupSrne(uint8_t rx_pin, uint8_t tx_pin);
+esp_err_t srneSubmitRequest(const SrneRequest &request, SrnePriority priority);
 esp_err_t writeDataWithRetry(uint16_t start_address, uint16_t value, uint8_t max_retry, uint16_t retry_interval_ms);
+esp_err_t writeBlockWithRetry(uint16_t start_address, uint16_t count, const uint16_t *values, uint8_t max_retry, uint16_t retry_interval_ms);
 esp_err_t setManualLoadPowerWithDuration(uint8_t power, uint16_t duration_s);
 
 // Configuration and Setup Functions
 esp_err_t setLithiumBattery(const deviceSettingPack &setting, uint8_t step_num);
 esp_err_t setLightControlVoltage(float voltage, uint8_t step_num = 0);
-esp_err_t setLoadPercentage(uint8_t percentage, uint8_t step_num = 0);
 esp_err_t setLoadSchedules(const loadScheduleSettingPack *schedules, uint8_t schedule_amount, uint8_t step_num = 0);
 esp_err_t setMaxChargeCurrent(float max_current, uint8_t step_num = 0);
+esp_err_t limitMaxChargeCurrent(float max_current); // For protective caps: always written, never waits on a telemetry read
 esp_err_t setMaxLoadCurrent(float max_current, uint8_t step_num = 0);
 esp_err_t setManualMode(uint8_t step_num = 0);
 esp_err_t factoryReset();
+
+// Configuration Shadow
+esp_err_t refreshConfigShadow();
+void invalidateConfigShadow();
+esp_err_t reconcileSrneConfig(const chargingProfilePack &profile, const deviceSettingPack &setting, const loadScheduleSettingPack *schedules, uint8_t schedule_amount);
 esp_err_t clearAccumulateData();
 
 // Data Acquisition Functions
-esp_err_t getLoadInfo(loadDataPack *load_data);
-esp_err_t getSolarInfo(solarDataPack *solar_data);
-esp_err_t getBatteryInfo(batteryDataPack *battery_data);
-esp_err_t getLoadWh(loadDataPack *load_data);
-esp_err_t getChargeWh(batteryDataPack *battery_data);
-esp_err_t updateEstimatedSOC(batteryDataPack *battery_data);
-// +++ START: เพิ่มการประกาศฟังก์ชันใหม่ +++
-esp_err_t get_energy(batteryDataPack *battery_data);
-// +++ END: เพิ่มการประกาศฟังก์ชันใหม่ +++
+esp_err_t getRealtimeInfo(batteryDataPack *battery_data, solarDataPack *solar_data, loadDataPack *load_data);
 
 #endif // HAL_SRNE_H
\ No newline at end of file
@@ -0,0 +1,68 @@
+// FILE: json_arena.h
+
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include "config.h"
+#include <ArduinoJson.h>
+
+// Preallocated memory for the JsonDocuments built on the publish path, so steady-state publishing
+// does not touch the heap. A document takes an arena from the pool for its lifetime through a
+// JsonArenaLease declared before it:
+//
+//     JsonArenaLease arena;
+//     JsonDocument doc(arena.allocator());
+//
+// Arenas are bump allocators reset when the lease ends. If every arena is leased, or a document
+// outgrows its arena, the overflow comes from the heap and is counted in heap_fallbacks; a
+// non-zero count means JSON_ARENA_SIZE is too small for the messages being built.
+
+const uint8_t JSON_ARENA_COUNT = 2;
+// A full batch with headroom: 12 KB on the ESP32. ArduinoJson's slots hold a pointer, so a 64-bit
+// host (tools/json_alloc_check) gets twice as much for the same documents.
+const size_t JSON_ARENA_SIZE = 12288 / 4 * sizeof(void *);
+
+struct JsonArenaStats {
+    uint32_t high_water_bytes; // Largest arena use by one document
+    uint32_t heap_fallbacks;   // Allocations that had to go to the heap
+};
+
+class JsonArena : public ArduinoJson::Allocator
+{
+public:
+    JsonArena(uint8_t *storage, size_t capacity);
+
+    void *allocate(size_t size) override;
+    void deallocate(void *ptr) override;
+    void *reallocate(void *ptr, size_t new_size) override;
+    void reset();
+
+    bool leased;
+
+private:
+    bool owns(const void *ptr) const;
+    size_t blockSize(const void *ptr) const;
+
+    uint8_t *storage;
+    size_t capacity;
+    size_t used;
+    uint8_t *last_block; // Only the newest block can grow in place or be given back
+};
+
+class JsonArenaLease
+{
+public:
+    JsonArenaLease();
+    ~JsonArenaLease();
+    ArduinoJson::Allocator *allocator();
+
+private:
+    JsonArenaLease(const JsonArenaLease &);
+    JsonArenaLease &operator=(const JsonArenaLease &);
+
+    JsonArena *arena; // NULL when the pool was exhausted
+};
+
+void jsonArenaGetStats(JsonArenaStats *stats);
+
+#endif // JSON_ARENA_H
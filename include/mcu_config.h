@@ -6,7 +6,7 @@
 #include "config.h"
 
 void setupMCU();
-esp_err_t setupTimer(float time_s);
+esp_err_t setupTimer(float time_s, TaskHandle_t dispatcher_task);
 void setupExternalInterrupt(uint8_t external_intterupt_pin, uint8_t tx_pin, uint8_t rx_pin);
 
 #endif // MCU_CONFIG_H
\ No newline at end of file
@@ -0,0 +1,36 @@
+// FILE: runtime_profile.h
+
+#ifndef RUNTIME_PROFILE_H
+#define RUNTIME_PROFILE_H
+
+#include "config.h"
+
+// Periodic FreeRTOS health sample: per-task CPU share over the last sampling window, stack
+// high-water marks and heap state. runtimeProfileSample() runs as a scheduler job; readers get
+// the latest completed sample.
+
+const uint8_t PROFILE_MAX_TASKS = 24;
+
+struct TaskProfile {
+    char name[16];
+    uint8_t priority;
+    int8_t core;                  // -1 = not pinned
+    int16_t cpu_permille;         // Share of both cores over the window; -1 without run-time stats
+    uint32_t stack_free_bytes;    // Minimum free stack ever seen (high-water mark)
+};
+
+struct RuntimeProfile {
+    uint32_t sampled_ms;          // 0 until the first sample
+    uint32_t window_ms;
+    uint8_t task_count;
+    TaskProfile tasks[PROFILE_MAX_TASKS];
+    uint32_t heap_free_bytes;
+    uint32_t heap_largest_block_bytes;
+    uint32_t heap_min_free_bytes; // Lowest free heap since boot
+};
+
+void runtimeProfileSample();
+void runtimeProfileGet(RuntimeProfile *profile);
+void runtimeProfilePrint();
+
+#endif // RUNTIME_PROFILE_H
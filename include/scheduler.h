@@ -0,0 +1,42 @@
+// FILE: scheduler.h
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "config.h"
+#include "exec_timing.h"
+
+// Table-driven periodic scheduler. Jobs are registered with a period, a deadline (relative to
+// their release) and a priority; the tick timer posts one notification per tick and the
+// dispatcher runs every released job, highest priority (lowest number) first. Jobs run to
+// completion on the dispatcher task, so a higher priority job released during a long one runs
+// next, not immediately.
+
+const uint32_t SCHEDULER_TICK_MS = 500; // Timer period; job periods are rounded to a multiple of it
+const uint8_t SCHEDULER_MAX_JOBS = 8;
+
+typedef void (*SchedulerJobFunction)();
+
+struct SchedulerJob {
+    const char *name;
+    SchedulerJobFunction run;
+    uint32_t period_ticks;
+    uint8_t priority;           // 0 = highest
+    uint32_t next_release_tick;
+    bool pending;
+    int64_t release_us;         // Release time of the pending run
+    uint32_t skipped;           // Releases dropped because the previous one had not started yet
+    ExecTimingStats timing;     // Run time, release jitter and deadline misses
+};
+
+esp_err_t schedulerAddJob(const char *name, SchedulerJobFunction run, uint32_t period_ms, uint32_t deadline_ms, uint8_t priority);
+
+// Starts the tick timer; dispatcher_task is the task that calls schedulerDispatch()
+esp_err_t schedulerStart(TaskHandle_t dispatcher_task);
+// Waits up to wait_ms for timer ticks, then runs every job they released
+void schedulerDispatch(uint32_t wait_ms);
+
+const SchedulerJob *schedulerJobs(uint8_t *count);
+void schedulerPrint();
+
+#endif // SCHEDULER_H
@@ -0,0 +1,46 @@
+// FILE: srne_link_stats.h
+
+#ifndef SRNE_LINK_STATS_H
+#define SRNE_LINK_STATS_H
+
+#include "config.h"
+
+// Health counters for the SRNE Modbus link. The bus task is the only writer; every counter is a
+// relaxed atomic so other tasks can take a snapshot at any time without a lock.
+
+const uint8_t SRNE_LINK_FUNCTION_COUNT = 3;   // FC 0x03, 0x06, 0x10
+const uint8_t SRNE_LINK_REGISTER_SLOTS = 24;  // Distinct request start addresses tracked
+const uint8_t SRNE_LATENCY_BUCKETS = 8;
+
+// Upper bound (ms) of each latency bucket, TX done to end of reply; the last bucket is open-ended
+const uint16_t SRNE_LATENCY_BUCKET_MS[SRNE_LATENCY_BUCKETS - 1] = {5, 10, 20, 40, 80, 160, 320};
+
+struct SrneLinkCounters {
+    uint32_t attempts;       // Frames sent
+    uint32_t successes;
+    uint32_t timeouts;       // No or short reply
+    uint32_t crc_errors;
+    uint32_t framing_errors; // UART framing/parity/overflow or a reply that does not match the request
+    uint32_t exceptions;     // Modbus exception replies
+    uint32_t retries;        // Attempts after the first one of a request
+};
+
+struct SrneFunctionStats {
+    uint8_t function_code;
+    SrneLinkCounters counters;
+    uint32_t latency_histogram[SRNE_LATENCY_BUCKETS];
+};
+
+struct SrneRegisterStats {
+    uint16_t start_address;
+    SrneLinkCounters counters;
+};
+
+// Called by the HAL once per frame sent. result is the frame builder's esp_err_t.
+void srneLinkRecordAttempt(uint8_t function_code, uint16_t start_address, esp_err_t result, uint32_t latency_us, bool is_retry);
+
+// Copies the per-function stats (SRNE_LINK_FUNCTION_COUNT entries) and up to max_registers
+// per-register entries. Returns the number of register entries written.
+uint8_t srneLinkStatsSnapshot(SrneFunctionStats *functions, SrneRegisterStats *registers, uint8_t max_registers);
+
+#endif // SRNE_LINK_STATS_H
@@ -0,0 +1,78 @@
+// FILE: srne_register_map.h
+
+#ifndef SRNE_REGISTER_MAP_H
+#define SRNE_REGISTER_MAP_H
+
+#include "config.h"
+#include <stddef.h>
+
+// ─────────────── REGISTER DESCRIPTORS ───────────────
+enum class SrnePack : uint8_t { BATTERY, SOLAR, LOAD };
+enum class SrneField : uint8_t { FLOAT, INT, UINT32 };
+enum class SrneSign : uint8_t {
+    UNSIGNED,        // Plain unsigned register (or register pair)
+    SIGNED_LOW_BYTE, // Low byte is a two's-complement int8 (temperature registers)
+};
+
+struct SrneRegisterDesc
+{
+    uint16_t address;
+    uint8_t width;   // 1 = 16-bit, 2 = 32-bit (high word first)
+    SrneSign sign;
+    double scale;
+    SrnePack pack;
+    SrneField field;
+    size_t offset;   // offsetof() the target field inside its pack
+};
+
+// ─────────────── TELEMETRY REGISTER MAP ───────────────
+constexpr SrneRegisterDesc SRNE_TELEMETRY_MAP[] = {
+    {0x0100, 1, SrneSign::UNSIGNED,        1.0,  SrnePack::BATTERY, SrneField::INT,    offsetof(batteryDataPack, battery_soc)},
+    {0x0101, 1, SrneSign::UNSIGNED,        0.1,  SrnePack::BATTERY, SrneField::FLOAT,  offsetof(batteryDataPack, battery_voltage)},
+    {0x0102, 1, SrneSign::UNSIGNED,        0.01, SrnePack::BATTERY, SrneField::FLOAT,  offsetof(batteryDataPack, battery_current)},
+    {0x0103, 1, SrneSign::SIGNED_LOW_BYTE, 1.0,  SrnePack::BATTERY, SrneField::INT,    offsetof(batteryDataPack, battery_temperature)},
+    {0x0104, 1, SrneSign::UNSIGNED,        0.1,  SrnePack::LOAD,    SrneField::FLOAT,  offsetof(loadDataPack, load_voltage)},
+    {0x0105, 1, SrneSign::UNSIGNED,        0.01, SrnePack::LOAD,    SrneField::FLOAT,  offsetof(loadDataPack, load_current)},
+    {0x0106, 1, SrneSign::UNSIGNED,        1.0,  SrnePack::LOAD,    SrneField::INT,    offsetof(loadDataPack, load_power)},
+    {0x0107, 1, SrneSign::UNSIGNED,        0.1,  SrnePack::SOLAR,   SrneField::FLOAT,  offsetof(solarDataPack, solar_voltage)},
+    {0x0108, 1, SrneSign::UNSIGNED,        0.01, SrnePack::SOLAR,   SrneField::FLOAT,  offsetof(solarDataPack, solar_current)},
+    {0x0109, 1, SrneSign::UNSIGNED,        1.0,  SrnePack::SOLAR,   SrneField::INT,    offsetof(solarDataPack, solar_power)},
+    {0x0118, 2, SrneSign::UNSIGNED,        1.0,  SrnePack::BATTERY, SrneField::UINT32, offsetof(batteryDataPack, total_charge_ah)},
+    {0x011A, 2, SrneSign::UNSIGNED,        1.0,  SrnePack::BATTERY, SrneField::UINT32, offsetof(batteryDataPack, total_discharge_ah)},
+    {0x011C, 2, SrneSign::UNSIGNED,        1.0,  SrnePack::BATTERY, SrneField::UINT32, offsetof(batteryDataPack, charge_wh)},
+    {0x011E, 2, SrneSign::UNSIGNED,        1.0,  SrnePack::LOAD,    SrneField::UINT32, offsetof(loadDataPack, load_wh)},
+};
+constexpr size_t SRNE_TELEMETRY_MAP_SIZE = sizeof(SRNE_TELEMETRY_MAP) / sizeof(SRNE_TELEMETRY_MAP[0]);
+
+// Contiguous ranges fetched in one FC 0x03 transaction each
+struct SrneRegisterBlock
+{
+    uint16_t start;
+    uint16_t count;
+};
+
+constexpr SrneRegisterBlock SRNE_REALTIME_BLOCK = {0x0100, 10}; // 0x0100-0x0109
+constexpr SrneRegisterBlock SRNE_TOTALS_BLOCK = {0x0118, 8};    // 0x0118-0x011F
+
+// Configuration ranges mirrored by the HAL's shadow cache
+constexpr SrneRegisterBlock SRNE_SETTINGS_BLOCK = {0xE001, 31};      // Charge current, battery parameters, light-control voltage
+constexpr SrneRegisterBlock SRNE_LOAD_SETTINGS_BLOCK = {0xE08D, 32}; // Max load current and the 9 load schedules
+constexpr SrneRegisterBlock SRNE_LOAD_COMMAND_BLOCK = {0xDF09, 3};   // Load mode, manual power, manual duration
+
+// ─────────────── COMPILE-TIME CHECKS ───────────────
+constexpr bool srneInBlock(const SrneRegisterDesc &d, const SrneRegisterBlock &b)
+{
+    return d.address >= b.start && d.address + d.width <= b.start + b.count;
+}
+
+constexpr bool srneMapCovered(size_t i = 0)
+{
+    return i >= SRNE_TELEMETRY_MAP_SIZE ||
+           ((srneInBlock(SRNE_TELEMETRY_MAP[i], SRNE_REALTIME_BLOCK) || srneInBlock(SRNE_TELEMETRY_MAP[i], SRNE_TOTALS_BLOCK)) &&
+            (SRNE_TELEMETRY_MAP[i].width == 1 || SRNE_TELEMETRY_MAP[i].width == 2) &&
+            srneMapCovered(i + 1));
+}
+
+static_assert(srneMapCovered(), "Every telemetry register must be 1 or 2 words wide and lie inside a polled block");
+
+#endif // SRNE_REGISTER_MAP_H
@@ -0,0 +1,69 @@
+// FILE: telemetry_codec.h
+
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include "config.h"
+#include "telemetry_store.h"
+
+// Wire formats for the telemetry message. The topic suffix names the format:
+//   JSON     <topic>        the original keyed object
+//   MSGPACK  <topic>/mp     the same object as MessagePack
+//   BINARY   <topic>/bin    the fixed record below
+// Batches use <topic>/batch plus the same suffix. Diagnostics go to <topic>/diag, as JSON in the
+// JSON format and as MessagePack in the others.
+enum class WireFormat : uint8_t { JSON = 0, MSGPACK = 1, BINARY = 2 };
+const uint8_t WIRE_FORMAT_COUNT = 3;
+
+// Binary record, version 1. Little-endian, no padding; "x100" means value * 100 rounded.
+//   off size  field
+//     0  1    version (TELEMETRY_BINARY_VERSION)
+//     1  1    flags: bit 0 = replayed from the outbox
+//     2  4    u32 timestamp, seconds since 1970-01-01 of the RTC's local time
+//     6  2    u16 load voltage x100        8  2  u16 load current x100
+//    10  2    u16 load power W            12  4  u32 load Wh
+//    16  2    u16 solar voltage x100      18  2  u16 solar current x100
+//    20  2    u16 solar power W
+//    22  2    u16 battery voltage x100    24  2  i16 battery current x100
+//    26  1    u8 battery SOC %            27  1  i8 battery temperature °C
+//    28  4    u32 charge Wh               32  2  u16 estimated SOC x10
+//    34  4    u32 total charge Ah         38  4  u32 total discharge Ah
+//    42  24   i32 x100: New_Wh, New_Wh_E, Full_Wh, Full_Wh_E, current_energy, current_energy_E,
+//             as captured with the sample
+// Out-of-range values saturate at the field limits.
+const uint8_t TELEMETRY_BINARY_VERSION = 1;
+const size_t TELEMETRY_BINARY_SIZE = 66;
+const uint8_t TELEMETRY_FLAG_REPLAYED = 0x01;
+
+size_t encodeTelemetryBinary(const TelemetrySnapshot &snapshot, bool replayed, uint8_t *out);
+const char *wireFormatSuffix(WireFormat format);
+uint32_t telemetryEpochSeconds(const timeDataPack &time_data); // RTC local time as if it were UTC
+
+// Batches store each field as a column. TELEMETRY_COLUMNS lists them in wire order, with the key
+// used by the keyed formats and the scaling used by the binary one.
+enum class ColumnType : uint8_t { U8, I8, U16, I16, U32 };
+
+struct TelemetryColumn {
+    const char *key;
+    ColumnType type;
+    float scale;
+    float (*read)(const TelemetrySnapshot &snapshot);
+};
+
+extern const TelemetryColumn TELEMETRY_COLUMNS[];
+extern const uint8_t TELEMETRY_COLUMN_COUNT;
+
+// Binary batch record, version 2. Little-endian, no padding.
+//   off size      field
+//     0  1        version (TELEMETRY_BATCH_VERSION)
+//     1  1        flags (as version 1)
+//     2  1        n, samples in the batch
+//     3  4        u32 base timestamp: seconds since 1970 of the first sample
+//     7  2n       u16 per-sample offsets from the base, seconds
+//     .  n*size   one block per TELEMETRY_COLUMNS entry, n values each, scaled as version 1
+//     .  24       i32 x100 energy totals of the last sample, as version 1
+const uint8_t TELEMETRY_BATCH_VERSION = 2;
+size_t telemetryBatchBinarySize(uint8_t count);
+size_t encodeTelemetryBatchBinary(const TelemetrySnapshot *samples, uint8_t count, uint8_t *out);
+
+#endif // TELEMETRY_CODEC_H
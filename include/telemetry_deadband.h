@@ -0,0 +1,34 @@
+// FILE: telemetry_deadband.h
+
+#ifndef TELEMETRY_DEADBAND_H
+#define TELEMETRY_DEADBAND_H
+
+#include "config.h"
+#include <ArduinoJson.h>
+
+// Report-by-exception for the live keyed (JSON / MessagePack) message. A field is sent only when
+// it has moved from the value last reported by at least its deadband: the larger of an absolute
+// step and a percentage of that value. Every keyframe_minutes the full message goes out tagged
+// "kf":1 so consumers can resynchronise; the first message, the first after a failed publish and
+// the first after a settings change are keyframes too. Binary records, batches and outbox replays
+// are always complete.
+
+struct DeadbandField {
+    const char *key;      // As in publishData()
+    float resolution;     // Value of one absolute step
+    uint8_t absolute;     // Steps of resolution
+    uint8_t relative_pct; // Of the last reported value
+};
+
+// keyframe_minutes = 0 turns report-by-exception off: every field in every message
+void setReportByException(uint8_t keyframe_minutes);
+bool reportByExceptionEnabled();
+esp_err_t setDeadband(uint8_t field, uint8_t absolute, uint8_t relative_pct);
+const DeadbandField *deadbandFields(uint8_t *count);
+
+// Publisher task only. deadbandFilter() removes the unchanged fields from doc and returns true for
+// a keyframe; deadbandCommit() then records the outcome of the publish.
+bool deadbandFilter(JsonDocument &doc);
+void deadbandCommit(bool published);
+
+#endif // TELEMETRY_DEADBAND_H
@@ -0,0 +1,31 @@
+// FILE: telemetry_document.h
+
+#ifndef TELEMETRY_DOCUMENT_H
+#define TELEMETRY_DOCUMENT_H
+
+#include "config.h"
+#include "telemetry_store.h"
+#include <ArduinoJson.h>
+
+// Builders for the keyed (JSON / MessagePack) messages, into a document the caller has leased
+// from the JSON arena. Nothing here touches the network, so tools/json_alloc_check builds the
+// same documents on the host and checks that they stay inside the arena.
+// Publisher task only.
+
+// Publish path heap counters, kept by connectivity_ota.cpp; see checkPublishHeap() there
+struct PublishHeapStats {
+    uint32_t checks;       // Publishes checked
+    uint32_t overruns;     // Publishes over the allowance
+    uint32_t worst_excess; // Bytes
+};
+
+// One sample; see publishData(). Returns true if the deadband filter ran, in which case the
+// caller reports the publish outcome with deadbandCommit().
+bool buildTelemetryDocument(JsonDocument &doc, const TelemetrySnapshot &snapshot, bool replayed);
+// count >= 1 samples, column by column; see publishBatch()
+void buildBatchDocument(JsonDocument &doc, const TelemetrySnapshot *samples, uint8_t count);
+// Link, job, outbox, arena and publish heap stats, plus the runtime profile if a sample newer
+// than profile_published_ms exists. Returns that sample's time, or 0 if none was added.
+uint32_t buildDiagnosticsDocument(JsonDocument &doc, const PublishHeapStats &publish_heap, uint32_t profile_published_ms);
+
+#endif // TELEMETRY_DOCUMENT_H
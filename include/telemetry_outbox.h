@@ -0,0 +1,32 @@
+// FILE: telemetry_outbox.h
+
+#ifndef TELEMETRY_OUTBOX_H
+#define TELEMETRY_OUTBOX_H
+
+#include "config.h"
+#include "telemetry_store.h"
+
+// Store-and-forward buffer for samples that could not be published. New records go to a RAM ring;
+// when it fills, the whole ring spills to a circular log in the "spiffs" data partition (nothing
+// mounts a filesystem there), which survives a reboot. Records replay oldest first. Once the log
+// is full the oldest records are overwritten and counted as dropped.
+// Owned by the publisher task: none of these functions may be called from another task.
+
+const uint8_t OUTBOX_RAM_RECORDS = 16;
+
+struct OutboxStats {
+    uint32_t pending;        // RAM + flash
+    uint32_t flash_capacity; // Records; 0 without a usable partition
+    uint32_t replayed;
+    uint32_t dropped;        // Oldest records lost to a full outbox
+    uint32_t flash_errors;
+};
+
+esp_err_t setupTelemetryOutbox();
+void outboxPush(const TelemetrySnapshot &snapshot);
+bool outboxPeek(TelemetrySnapshot *snapshot); // Oldest pending record
+void outboxPop();                             // Marks the record returned by outboxPeek() delivered
+uint32_t outboxPending();
+void outboxGetStats(OutboxStats *stats);
+
+#endif // TELEMETRY_OUTBOX_H
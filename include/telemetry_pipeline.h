@@ -0,0 +1,39 @@
+// FILE: telemetry_pipeline.h
+
+#ifndef TELEMETRY_PIPELINE_H
+#define TELEMETRY_PIPELINE_H
+
+#include "config.h"
+#include "telemetry_store.h"
+#include "exec_timing.h"
+
+// Hands telemetry from the acquisition job (core 1) to the publisher task (core 0) through a
+// single-producer/single-consumer lock-free ring, so a slow broker never delays a sample.
+
+const uint8_t TELEMETRY_RING_SIZE = 8; // Power of two
+const uint8_t TELEMETRY_BATCH_MAX_SAMPLES = 32;
+
+// Batching mode: every acquired sample is kept and sent column-wise in one message, flushed when
+// max_samples are held, when the oldest is max_age_s old, or (flush_on_alarm) as soon as a
+// protection threshold trips. max_samples <= 1 turns batching off and the publish period applies.
+struct BatchPolicy {
+    uint8_t max_samples;
+    uint16_t max_age_s;
+    bool flush_on_alarm;
+};
+
+esp_err_t startTelemetryPipeline(uint32_t publish_period_ms, const char *publish_topic);
+void setPublishPeriod(uint32_t publish_period_ms);
+void setBatchPolicy(const BatchPolicy &policy);
+
+// Producer side; call only from the acquisition job. Returns false (and counts a drop) when the
+// publisher has fallen TELEMETRY_RING_SIZE snapshots behind.
+bool submitTelemetrySnapshot(const TelemetrySnapshot &snapshot);
+
+uint32_t telemetrySnapshotsDropped();
+
+// Run time of each publish (live sample, batch or replay, including the diagnostics message sent
+// after a live one once a minute), as an execution timing table
+void publishTimingPrint();
+
+#endif // TELEMETRY_PIPELINE_H
@@ -0,0 +1,31 @@
+// FILE: telemetry_store.h
+
+#ifndef TELEMETRY_STORE_H
+#define TELEMETRY_STORE_H
+
+#include "config.h"
+
+// Latest telemetry record, shared by the acquisition job (the only writer), the control jobs, the
+// publisher and the scheduler tick (timerTick, on the esp_timer task). It is a seqlock over two
+// copies (a "latch"): the writer never waits, and a reader always finds one copy that is not
+// being written, so readers only retry when the writer runs concurrently on the other core and a
+// task that preempts the writer never spins.
+
+// captured_us comes first so no padding is needed. The record is 112 bytes and must stay small
+// enough for a 128-byte outbox slot (see FlashRecord in telemetry_outbox.cpp).
+struct TelemetrySnapshot {
+    int64_t captured_us; // esp_timer time of the write
+    uint32_t sequence;   // Records written so far; 0 = nothing acquired yet
+    batteryDataPack battery;
+    solarDataPack solar;
+    loadDataPack load;
+    timeDataPack time;
+    energyDataPack energy;
+};
+
+// Stamps sequence and captured_us into *snapshot and makes it the current record
+void telemetryStoreWrite(TelemetrySnapshot *snapshot);
+// Copies the current record; safe from any task. Not for ISRs: a snapshot is too large to copy there.
+void telemetryStoreRead(TelemetrySnapshot *snapshot);
+
+#endif // TELEMETRY_STORE_H
@@ -0,0 +1,37 @@
+// FILE: threshold_monitor.h
+
+#ifndef THRESHOLD_MONITOR_H
+#define THRESHOLD_MONITOR_H
+
+#include "config.h"
+#include "telemetry_store.h"
+
+// Protection limits checked on every acquisition sample. A rule trips when its signal reaches
+// trip_level and re-arms once it falls below release_level; while tripped it caps the SRNE max
+// charge current. The cap is applied straight away as a control-priority Modbus write, so the
+// reaction time is bounded by the sampling period.
+
+enum class ThresholdSignal : uint8_t { BATTERY_VOLTAGE, BATTERY_TEMPERATURE };
+const uint8_t THRESHOLD_SIGNAL_COUNT = 2;
+
+struct ThresholdRule {
+    const char *name;
+    ThresholdSignal signal;
+    float trip_level;
+    float release_level;
+    float charge_current_limit; // A, applied while tripped
+    bool tripped;
+    uint32_t trip_count;
+};
+
+void thresholdMonitorEvaluate(const TelemetrySnapshot &telemetry);
+// Any task. The defaults are in config.h; the command port changes them and setup() restores them.
+esp_err_t thresholdSetLimits(ThresholdSignal signal, float trip_level, float release_level);
+
+// Writes charge_profile.max_charge_current capped by every tripped rule. Use this instead of
+// setMaxChargeCurrent() so a profile update cannot lift an active protection.
+esp_err_t applyChargeCurrent();
+
+const ThresholdRule *thresholdRules(uint8_t *count);
+
+#endif // THRESHOLD_MONITOR_H
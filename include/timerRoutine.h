@@ -8,12 +8,14 @@
 #include "hal_rtc.h"
 #include "model.h"
 #include "connectivity_ota.h"
+#include "telemetry_store.h"
+#include "telemetry_pipeline.h"
+#include "threshold_monitor.h"
 
 void slot_1_update_data();
 void slot_2_safety_checks();
 void slot_3_forecasting_and_adjustment();
 void slot_4_integration_check();
-void slot_5_publish_data();
 
 // +++ START: เพิ่มการประกาศฟังก์ชันใหม่ +++
 void slot_6_Load_Control();
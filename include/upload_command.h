@@ -6,6 +6,13 @@
 #include "config.h"
 #include "nvs_utils.h"
 #include "hal_srne.h"
+#include "scheduler.h"
+#include "telemetry_pipeline.h"
+#include "runtime_profile.h"
+#include "boot_trace.h"
+#include "connectivity_ota.h"
+#include "telemetry_deadband.h"
+#include "threshold_monitor.h"
 
 void resetListenerTask(void *parameter);
 esp_err_t updateTime(uint16_t *time_package); // This seems unused, but keeping declaration
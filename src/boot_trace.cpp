@@ -0,0 +1,71 @@
+// FILE: boot_trace.cpp
+
+#include "boot_trace.h"
+#include "esp_timer.h"
+
+// --- Module-level (static) variables ---
+static BootTraceEvent events[BOOT_TRACE_CAPACITY];
+static uint32_t next_event = 0; // Total marks ever recorded
+static portMUX_TYPE trace_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// --- Public Function Implementations ---
+
+void bootTraceMark(const char *phase)
+{
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+
+    portENTER_CRITICAL(&trace_mux);
+    BootTraceEvent &event = events[next_event % BOOT_TRACE_CAPACITY];
+    event.phase = phase;
+    event.at_us = now_us;
+    next_event++;
+    portEXIT_CRITICAL(&trace_mux);
+}
+
+uint8_t bootTraceSnapshot(BootTraceEvent *out, uint8_t max_events)
+{
+    portENTER_CRITICAL(&trace_mux);
+    uint32_t recorded = next_event < BOOT_TRACE_CAPACITY ? next_event : BOOT_TRACE_CAPACITY;
+    uint8_t count = recorded < max_events ? recorded : max_events;
+    uint32_t first = next_event - recorded;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        out[i] = events[(first + i) % BOOT_TRACE_CAPACITY];
+    }
+    portEXIT_CRITICAL(&trace_mux);
+
+    return count;
+}
+
+const char *bootTraceResetReason()
+{
+    switch (esp_reset_reason())
+    {
+        case ESP_RST_POWERON:   return "power-on";
+        case ESP_RST_EXT:       return "external";
+        case ESP_RST_SW:        return "software";
+        case ESP_RST_PANIC:     return "panic";
+        case ESP_RST_INT_WDT:   return "interrupt-wdt";
+        case ESP_RST_TASK_WDT:  return "task-wdt";
+        case ESP_RST_WDT:       return "wdt";
+        case ESP_RST_DEEPSLEEP: return "deep-sleep";
+        case ESP_RST_BROWNOUT:  return "brownout";
+        default:                return "unknown";
+    }
+}
+
+void bootTracePrint()
+{
+    BootTraceEvent snapshot[BOOT_TRACE_CAPACITY];
+    uint8_t count = bootTraceSnapshot(snapshot, BOOT_TRACE_CAPACITY);
+
+    Serial.printf("========== Boot timeline (reset: %s) ===========================\n", bootTraceResetReason());
+    Serial.println("  Phase                  At (ms)   Step (ms)");
+    uint32_t previous_us = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        Serial.printf("  %-20s %9.1f %11.1f\n", snapshot[i].phase, snapshot[i].at_us / 1000.0, (snapshot[i].at_us - previous_us) / 1000.0);
+        previous_us = snapshot[i].at_us;
+    }
+    Serial.println("--------------------------------------------------------------");
+}
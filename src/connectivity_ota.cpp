@@ -1,76 +1,128 @@
 // FILE: connectivity_ota.cpp
 
 #include "connectivity_ota.h"
+#include "boot_trace.h"
+#include "telemetry_codec.h"
+#include "telemetry_deadband.h"
+#include "telemetry_document.h"
+#include "json_arena.h"
+#include "esp_heap_caps.h"
 #include <ArduinoJson.h>
+#include <atomic>
 
 // --- Module-level (static) variables ---
 static WiFiClient espClient;
 static PubSubClient client(espClient);
 static AsyncWebServer server(80);
 static SemaphoreHandle_t mqttMutex = xSemaphoreCreateMutex();
+static const uint16_t MQTT_BUFFER_SIZE = 512; // Connect packet and publish headers; payloads are streamed
+static const uint16_t OTA_POLL_INTERVAL_MS = 250;
+static std::atomic<bool> mqtt_link_up(false); // Maintained by keepWiFiMqttAlive()
+static std::atomic<uint8_t> wire_format((uint8_t)WireFormat::JSON);
+static const uint32_t DIAGNOSTICS_PERIOD_MS = 60000; // Diagnostics message on <topic>/diag
+static const size_t MQTT_STREAM_CHUNK = 256;
+static const size_t PUBLISH_HEAP_SEGMENT_OVERHEAD = 160; // lwIP pbuf, segment and headers per write
 
-// --- Public Function Implementations ---
+// Publish path heap check, see checkPublishHeap()
+static std::atomic<uint32_t> publish_heap_checks(0);
+static std::atomic<uint32_t> publish_heap_overruns(0);
+static std::atomic<uint32_t> publish_heap_worst_excess(0);
 
-esp_err_t setupWiFi(wifiConfig wifi_parameter)
+// Collects serializer output into MQTT_STREAM_CHUNK-byte writes, so the socket is not fed one
+// character at a time
+class MqttPayloadStream : public Print
 {
-    WiFi.mode(WIFI_STA);
-    WiFi.setAutoReconnect(true);
-    WiFi.begin(wifi_parameter.ssid, wifi_parameter.password);
+public:
+    explicit MqttPayloadStream(PubSubClient &mqtt) : failed(false), mqtt(mqtt), used(0) {}
 
-    Serial.print("📡 Connecting to WiFi...");
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 20)
+    size_t write(uint8_t byte) override
     {
-        delay(500);
-        Serial.print(".");
-        attempts++;
+        if (used == sizeof(chunk)) send();
+        chunk[used++] = byte;
+        return 1;
     }
 
-    if (WiFi.status() == WL_CONNECTED)
+    size_t write(const uint8_t *data, size_t length) override
     {
-        Serial.println("\n✅ WiFi Connected!");
-        Serial.print("   IP Address: ");
-        Serial.println(WiFi.localIP());
-        return ESP_OK;
+        for (size_t i = 0; i < length; i++)
+        {
+            write(data[i]);
+        }
+        return length;
     }
-    else
+
+    void send()
+    {
+        if (used > 0 && mqtt.write(chunk, used) != used) failed = true;
+        used = 0;
+    }
+
+    bool failed;
+
+private:
+    PubSubClient &mqtt;
+    uint8_t chunk[MQTT_STREAM_CHUNK];
+    size_t used;
+};
+
+// --- Private Function Prototypes ---
+static esp_err_t publishDiagnostics(const char *publish_topic);
+static void publishDiagnosticsIfDue(const char *publish_topic);
+static esp_err_t publishPayload(const char *topic, const uint8_t *payload, size_t length);
+static esp_err_t publishDocument(const char *topic, JsonDocument &doc, bool msgpack);
+static void checkPublishHeap(size_t free_before, size_t length);
+
+// --- Public Function Implementations ---
+
+// Starts association and returns; keepWiFiMqttAlive() waits for it and opens the MQTT session,
+// so boot can configure the controller meanwhile
+esp_err_t setupWiFi(wifiConfig wifi_parameter)
+{
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(true);
+    if (WiFi.begin(wifi_parameter.ssid, wifi_parameter.password) == WL_CONNECT_FAILED)
     {
-        Serial.println("\n❌ WiFi Connection Failed!");
+        Serial.println("❌ WiFi association could not be started!");
         return ESP_FAIL;
     }
+
+    Serial.println("📡 Connecting to WiFi in the background...");
+    return ESP_OK;
 }
 
+// Configures the client only; the first connect happens on WiFiMqttTask once WiFi is up
 esp_err_t setupMQTT(MqttConfig mqtt_parameter)
 {
     client.setServer(mqtt_parameter.server, mqtt_parameter.port);
-    
-    if (WiFi.status() == WL_CONNECTED)
-    {
-        if (client.connect(mqtt_parameter.client_name, mqtt_parameter.username, mqtt_parameter.password))
-        {
-            Serial.println("[MQTT] Connected!");
-            return ESP_OK;
-        }
-        else
-        {
-            return ESP_FAIL;
-        }
-    }
-
-    return ESP_FAIL;
+    client.setBufferSize(MQTT_BUFFER_SIZE);
+    return ESP_OK;
 }
 
 void keepWiFiMqttAlive(void *parameter)
 {
     static const uint16_t delay_time_ms = 250;
+    static const uint16_t associate_timeout_ms = 10000;
     client.setKeepAlive(60);
 
+    // Let the association started by setupWiFi() finish before the reconnect path can restart it
+    for (uint16_t waited_ms = 0; WiFi.status() != WL_CONNECTED && waited_ms < associate_timeout_ms; waited_ms += 100)
+    {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    if (WiFi.status() == WL_CONNECTED)
+    {
+        bootTraceMark("wifi_associated");
+        Serial.print("✅ WiFi Connected! IP Address: ");
+        Serial.println(WiFi.localIP());
+    }
+
     for (;;)
     {
         esp_task_wdt_reset();
 
         if (WiFi.status() != WL_CONNECTED || WiFi.localIP() == IPAddress(0, 0, 0, 0))
         {
+            mqtt_link_up.store(false, std::memory_order_relaxed);
             Serial.println("⚠️ WiFi Disconnected! Attempting to reconnect...");
 
             WiFi.disconnect();
@@ -100,6 +152,7 @@ void keepWiFiMqttAlive(void *parameter)
         }
         else if (WiFi.status() == WL_CONNECTED && !client.connected())
         {
+            mqtt_link_up.store(false, std::memory_order_relaxed);
             Serial.println("⚠️ MQTT Disconnected while WiFi is Connected! Attempting to reconnect...");
             client.disconnect();
 
@@ -123,6 +176,12 @@ void keepWiFiMqttAlive(void *parameter)
                 if (client.connect(myMQTT.client_name, myMQTT.username, myMQTT.password))
                 {
                     mqttReconnected = true;
+                    static bool first_connect_traced = false;
+                    if (!first_connect_traced)
+                    {
+                        first_connect_traced = true;
+                        bootTraceMark("mqtt_connected");
+                    }
                     Serial.println("✅ MQTT Reconnected!");
                     break;
                 }
@@ -143,6 +202,7 @@ void keepWiFiMqttAlive(void *parameter)
         }
         else if (WiFi.status() == WL_CONNECTED && client.connected())
         {
+            mqtt_link_up.store(true, std::memory_order_relaxed);
             if (xSemaphoreTake(mqttMutex, pdMS_TO_TICKS(100)) == pdTRUE)
             {
                 client.loop();
@@ -155,63 +215,223 @@ void keepWiFiMqttAlive(void *parameter)
     }
 }
 
-esp_err_t publishData(const loadDataPack &load_data, const solarDataPack &solar_data, const batteryDataPack &battery_data, const timeDataPack &time_data, const char *publish_topic)
+bool mqttLinkUp()
 {
-    const uint16_t PACKAGE_SIZE = 1024;
-    const TickType_t publishTimeout = pdMS_TO_TICKS(500);
+    return mqtt_link_up.load(std::memory_order_relaxed);
+}
+
+void setWireFormat(WireFormat format)
+{
+    wire_format.store((uint8_t)format, std::memory_order_relaxed);
+}
+
+WireFormat wireFormat()
+{
+    return (WireFormat)wire_format.load(std::memory_order_relaxed);
+}
+
+esp_err_t publishData(const TelemetrySnapshot &snapshot, const char *publish_topic, bool replayed)
+{
+    if (WiFi.status() != WL_CONNECTED || !client.connected())
+    {
+        return ESP_FAIL;
+    }
+
+    WireFormat format = wireFormat();
+    char topic[96];
+    snprintf(topic, sizeof(topic), "%s%s", publish_topic, wireFormatSuffix(format));
+
+    if (format == WireFormat::BINARY)
+    {
+        uint8_t record[TELEMETRY_BINARY_SIZE];
+        size_t n = encodeTelemetryBinary(snapshot, replayed, record);
+        esp_err_t result = publishPayload(topic, record, n);
+        if (result == ESP_OK && !replayed) publishDiagnosticsIfDue(publish_topic);
+        return result;
+    }
+
+    JsonArenaLease arena;
+    JsonDocument doc(arena.allocator());
+    bool filtered = buildTelemetryDocument(doc, snapshot, replayed);
+
+    esp_err_t result = publishDocument(topic, doc, format == WireFormat::MSGPACK);
+    if (filtered) deadbandCommit(result == ESP_OK);
+    if (result == ESP_OK && !replayed) publishDiagnosticsIfDue(publish_topic);
+    return result;
+}
+
+// Column-wise batch on <topic>/batch[suffix]: {"n", "t0": epoch seconds of the first sample,
+// "dt": [offsets in s], one array per TELEMETRY_COLUMNS key, energy totals of the last sample},
+// or the version 2 binary record
+esp_err_t publishBatch(const TelemetrySnapshot *samples, uint8_t count, const char *publish_topic)
+{
+    static uint8_t record[1280]; // Publisher task only; a full binary batch is 1247 bytes
 
+    if (count == 0) return ESP_OK;
     if (WiFi.status() != WL_CONNECTED || !client.connected())
     {
         return ESP_FAIL;
     }
 
-    JsonDocument doc;
-    
-    doc["lv"] = load_data.load_voltage;
-    doc["lc"] = load_data.load_current;
-    doc["lp"] = load_data.load_power;
-    doc["lw"] = load_data.load_wh;
-    doc["sv"] = solar_data.solar_voltage;
-    doc["sc"] = solar_data.solar_current;
-    doc["sp"] = solar_data.solar_power;
-    doc["bv"] = battery_data.battery_voltage;
-    doc["bc"] = battery_data.battery_current;
-    doc["bs"] = battery_data.battery_soc;
-    doc["bt"] = battery_data.battery_temperature;
-    doc["cw"] = battery_data.charge_wh; // Total Charge Wh (0x011C)
-    doc["bse"] = round(battery_data.battery_soc_estimated * 10) / 10.0;
-
-    // +++ START: เพิ่มค่าใหม่ลงใน JSON +++
-    doc["tcah"] = battery_data.total_charge_ah; // Total Charge Ah (0x0118)
-    doc["tdah"] = battery_data.total_discharge_ah; // Total Discharge Ah (0x011A)
-    // +++ END: เพิ่มค่าใหม่ลงใน JSON +++
-    
-    doc["nw"] = round(New_Wh * 100) / 100.0;
-    doc["nwe"] = round(New_Wh_E * 100) / 100.0;
-    doc["fwh"] = round(Full_Wh * 100) / 100.0;
-    doc["fwe"] = round(Full_Wh_E * 100) / 100.0;
-    doc["ce"] = round(current_energy * 100) / 100.0;
-    doc["cee"] = round(current_energy_E * 100) / 100.0;
-
-    char timestamp[25];
-    snprintf(timestamp, sizeof(timestamp), "%04d-%02d-%02dT%02d:%02d:%02d", 
-             time_data.year, time_data.month, time_data.day, 
-             time_data.hour, time_data.minute, time_data.second);
-    doc["timestamp"] = timestamp;
-
-    char buffer[PACKAGE_SIZE];
-    size_t n = serializeJson(doc, buffer);
+    WireFormat format = wireFormat();
+    char topic[96];
+    snprintf(topic, sizeof(topic), "%s/batch%s", publish_topic, wireFormatSuffix(format));
+
+    if (format == WireFormat::BINARY)
+    {
+        if (telemetryBatchBinarySize(count) > sizeof(record)) return ESP_ERR_INVALID_SIZE;
+        size_t n = encodeTelemetryBatchBinary(samples, count, record);
+        esp_err_t result = publishPayload(topic, record, n);
+        if (result == ESP_OK) publishDiagnosticsIfDue(publish_topic);
+        return result;
+    }
+
+    JsonArenaLease arena;
+    JsonDocument doc(arena.allocator());
+    buildBatchDocument(doc, samples, count);
+
+    esp_err_t result = publishDocument(topic, doc, format == WireFormat::MSGPACK);
+    if (result == ESP_OK) publishDiagnosticsIfDue(publish_topic);
+    return result;
+}
+
+// {"rr": reset reason, "ev": [[phase, ms since start], ...]}, oldest first
+esp_err_t publishBootTrace(const char *publish_topic)
+{
+    if (WiFi.status() != WL_CONNECTED || !client.connected())
+    {
+        return ESP_FAIL;
+    }
+
+    BootTraceEvent events[BOOT_TRACE_CAPACITY];
+    uint8_t count = bootTraceSnapshot(events, BOOT_TRACE_CAPACITY);
+
+    JsonArenaLease arena;
+    JsonDocument doc(arena.allocator());
+    doc["rr"] = bootTraceResetReason();
+    JsonArray timeline = doc["ev"].to<JsonArray>();
+    for (uint8_t i = 0; i < count; i++)
+    {
+        JsonArray event = timeline.add<JsonArray>();
+        event.add(events[i].phase);
+        event.add(events[i].at_us / 1000);
+    }
+
+    return publishDocument(publish_topic, doc, false);
+}
+
+// Diagnostics on <topic>/diag: JSON in the JSON wire format, MessagePack otherwise
+static esp_err_t publishDiagnostics(const char *publish_topic)
+{
+    static uint32_t profile_published_ms = 0; // The runtime profile goes out once per sample
+
+    PublishHeapStats publish_heap;
+    publish_heap.checks = publish_heap_checks.load(std::memory_order_relaxed);
+    publish_heap.overruns = publish_heap_overruns.load(std::memory_order_relaxed);
+    publish_heap.worst_excess = publish_heap_worst_excess.load(std::memory_order_relaxed);
+
+    JsonArenaLease arena;
+    JsonDocument doc(arena.allocator());
+    uint32_t profile_ms = buildDiagnosticsDocument(doc, publish_heap, profile_published_ms);
 
+    char topic[96];
+    snprintf(topic, sizeof(topic), "%s/diag", publish_topic);
+    esp_err_t result = publishDocument(topic, doc, wireFormat() != WireFormat::JSON);
+    if (result == ESP_OK && profile_ms != 0) profile_published_ms = profile_ms;
+    return result;
+}
+
+// Called after each successful live publish, so diagnostics only go out while telemetry does.
+// Publisher task only.
+static void publishDiagnosticsIfDue(const char *publish_topic)
+{
+    static bool sent = false;
+    static uint32_t last_sent_ms = 0;
+
+    if (sent && millis() - last_sent_ms < DIAGNOSTICS_PERIOD_MS) return;
+    if (publishDiagnostics(publish_topic) == ESP_OK)
+    {
+        sent = true;
+        last_sent_ms = millis();
+    }
+}
+
+// Header first, then the payload straight to the socket: nothing is copied into PubSubClient's
+// buffer, so it does not need to fit a whole message
+static esp_err_t publishPayload(const char *topic, const uint8_t *payload, size_t length)
+{
+    const TickType_t publishTimeout = pdMS_TO_TICKS(500);
+
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
     bool success = false;
     if (xSemaphoreTake(mqttMutex, publishTimeout) == pdTRUE)
     {
-        success = client.publish(publish_topic, buffer, n);
+        if (client.beginPublish(topic, length, false))
+        {
+            success = client.write(payload, length) == length && client.endPublish();
+            if (!success) client.disconnect(); // A short payload leaves the session out of step
+        }
         xSemaphoreGive(mqttMutex);
     }
-    
+    checkPublishHeap(free_before, length);
+
     return success ? ESP_OK : ESP_FAIL;
 }
 
+// Serializes doc while it is sent, after measuring it for the MQTT length field. The payload
+// never exists in RAM as a whole.
+static esp_err_t publishDocument(const char *topic, JsonDocument &doc, bool msgpack)
+{
+    const TickType_t publishTimeout = pdMS_TO_TICKS(500);
+
+    if (doc.overflowed()) return ESP_ERR_NO_MEM;
+    size_t length = msgpack ? measureMsgPack(doc) : measureJson(doc);
+
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    bool success = false;
+    if (xSemaphoreTake(mqttMutex, publishTimeout) == pdTRUE)
+    {
+        if (client.beginPublish(topic, length, false))
+        {
+            MqttPayloadStream stream(client);
+            size_t written = msgpack ? serializeMsgPack(doc, stream) : serializeJson(doc, stream);
+            stream.send();
+            success = !stream.failed && written == length && client.endPublish();
+            if (!success) client.disconnect(); // A short payload leaves the session out of step
+        }
+        xSemaphoreGive(mqttMutex);
+    }
+    checkPublishHeap(free_before, length);
+
+    return success ? ESP_OK : ESP_FAIL;
+}
+
+// Free 8-bit heap after a publish against before it. lwIP keeps a copy of the payload until the
+// broker acknowledges it, so the payload plus per-segment overhead may still be out when the
+// publish returns; a shortfall beyond that was allocated on the publish path (PubSubClient,
+// WiFiClient, lwIP) and not given back. Allocations by other tasks in the meantime count too, so
+// a rare overrun is noise and a steady one is a leak.
+static void checkPublishHeap(size_t free_before, size_t length)
+{
+    size_t free_after = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    publish_heap_checks.fetch_add(1, std::memory_order_relaxed);
+    if (free_after >= free_before) return;
+
+    size_t writes = (length + MQTT_STREAM_CHUNK - 1) / MQTT_STREAM_CHUNK + 1; // Plus the header
+    size_t allowance = length + writes * PUBLISH_HEAP_SEGMENT_OVERHEAD;
+    size_t shortfall = free_before - free_after;
+    if (shortfall <= allowance) return;
+
+    uint32_t excess = shortfall - allowance;
+    publish_heap_overruns.fetch_add(1, std::memory_order_relaxed);
+    if (excess > publish_heap_worst_excess.load(std::memory_order_relaxed))
+    {
+        publish_heap_worst_excess.store(excess, std::memory_order_relaxed);
+        Serial.printf("⚠️ Publish of %u bytes left %u bytes of heap in use (%u over the allowance)\n",
+                      (unsigned)length, (unsigned)shortfall, (unsigned)excess);
+    }
+}
+
 void elegantTask(void *parameter)
 {
     const char *ota_username = "charaphat";
@@ -224,6 +444,6 @@ void elegantTask(void *parameter)
     for (;;)
     {
         ElegantOTA.loop();
-        vTaskDelay(pdMS_TO_TICKS(10)); 
+        vTaskDelay(pdMS_TO_TICKS(OTA_POLL_INTERVAL_MS)); // Only polls for a pending reboot after an upload
     }
 }
\ No newline at end of file
@@ -0,0 +1,64 @@
+// FILE: crc_utils.cpp
+
+#include "crc_utils.h"
+
+// --- Compile-time table generation (C++11 constexpr) ---
+template <size_t... I> struct CrcIndices {};
+template <size_t N, size_t... I> struct MakeCrcIndices : MakeCrcIndices<N - 1, N - 1, I...> {};
+template <size_t... I> struct MakeCrcIndices<0, I...> { typedef CrcIndices<I...> type; };
+
+constexpr uint16_t crc16Entry(uint16_t crc, int bits)
+{
+    return bits == 0 ? crc : crc16Entry((crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1, bits - 1);
+}
+
+constexpr uint32_t crc32Entry(uint32_t crc, int bits)
+{
+    return bits == 0 ? crc : crc32Entry((crc & 1) ? (crc >> 1) ^ 0xEDB88320UL : crc >> 1, bits - 1);
+}
+
+struct Crc16Table { uint16_t entry[256]; };
+struct Crc32Table { uint32_t entry[256]; };
+
+template <size_t... I>
+constexpr Crc16Table makeCrc16Table(CrcIndices<I...>) { return Crc16Table{{crc16Entry(I, 8)...}}; }
+
+template <size_t... I>
+constexpr Crc32Table makeCrc32Table(CrcIndices<I...>) { return Crc32Table{{crc32Entry(I, 8)...}}; }
+
+static constexpr Crc16Table CRC16_TABLE = makeCrc16Table(MakeCrcIndices<256>::type());
+static constexpr Crc32Table CRC32_TABLE = makeCrc32Table(MakeCrcIndices<256>::type());
+
+static_assert(CRC16_TABLE.entry[1] == 0xC0C1 && CRC16_TABLE.entry[255] == 0x4040, "CRC-16/MODBUS table mismatch");
+static_assert(CRC32_TABLE.entry[1] == 0x77073096UL && CRC32_TABLE.entry[255] == 0x2D02EF8DUL, "CRC-32 table mismatch");
+
+// --- Public Function Implementations ---
+
+uint16_t crc16ModbusUpdate(uint16_t crc, const uint8_t *data, size_t length)
+{
+    while (length--)
+    {
+        crc = (crc >> 8) ^ CRC16_TABLE.entry[(crc ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+uint16_t crc16Modbus(const uint8_t *data, size_t length)
+{
+    return crc16ModbusUpdate(CRC16_MODBUS_INIT, data, length);
+}
+
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t length)
+{
+    crc = ~crc;
+    while (length--)
+    {
+        crc = (crc >> 8) ^ CRC32_TABLE.entry[(crc ^ *data++) & 0xFF];
+    }
+    return ~crc;
+}
+
+uint32_t crc32(const uint8_t *data, size_t length)
+{
+    return crc32Update(0, data, length);
+}
@@ -0,0 +1,79 @@
+// FILE: exec_timing.cpp
+
+#include "exec_timing.h"
+#include <Arduino.h>
+
+// --- Module-level (static) variables ---
+// Records and snapshots can come from different tasks and cores; the sections are a few dozen
+// instructions long
+static portMUX_TYPE exec_timing_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// --- Private Function Prototypes ---
+static void recordRun(ExecTimingStats &stats, int64_t start_us, uint32_t elapsed_us, uint32_t response_us, bool has_jitter, int64_t jitter_us);
+
+// --- Public Function Implementations ---
+
+void execTimingRecord(ExecTimingStats &stats, int64_t start_us, int64_t end_us)
+{
+    uint32_t elapsed_us = (uint32_t)(end_us - start_us);
+    // Unlocked read: last_start_us is only written by the task that records into these stats
+    bool has_jitter = stats.period_us != 0 && stats.last_start_us != 0;
+    int64_t jitter_us = has_jitter ? start_us - stats.last_start_us - (int64_t)stats.period_us : 0;
+    recordRun(stats, start_us, elapsed_us, elapsed_us, has_jitter, jitter_us);
+}
+
+void execTimingRecordRelease(ExecTimingStats &stats, int64_t release_us, int64_t start_us, int64_t end_us)
+{
+    recordRun(stats, start_us, (uint32_t)(end_us - start_us), (uint32_t)(end_us - release_us), true, start_us - release_us);
+}
+
+void execTimingSnapshot(const ExecTimingStats &stats, ExecTimingStats *copy)
+{
+    portENTER_CRITICAL(&exec_timing_mux);
+    *copy = stats;
+    portEXIT_CRITICAL(&exec_timing_mux);
+}
+
+uint32_t execTimingMeanUs(const ExecTimingStats &stats)
+{
+    return stats.count ? (uint32_t)(stats.total_us / stats.count) : 0;
+}
+
+void execTimingPrint(const ExecTimingStats *const *stats, size_t count)
+{
+    Serial.println("========== Execution Timing ==================================");
+    Serial.println("  name        runs    min ms   mean ms    max ms   misses  jitter (<1/<5/<20/<100/<500/<1000/more ms)");
+    for (size_t i = 0; i < count; i++)
+    {
+        ExecTimingStats snapshot;
+        execTimingSnapshot(*stats[i], &snapshot);
+        Serial.printf("  %-10s %5u %9.1f %9.1f %9.1f %8u  ",
+                      snapshot.name, (unsigned)snapshot.count, snapshot.min_us / 1000.0, execTimingMeanUs(snapshot) / 1000.0,
+                      snapshot.max_us / 1000.0, (unsigned)snapshot.deadline_misses);
+        for (uint8_t b = 0; b < EXEC_JITTER_BUCKETS; b++)
+        {
+            Serial.printf("%s%u", b ? "/" : "", (unsigned)snapshot.jitter_histogram[b]);
+        }
+        Serial.println();
+    }
+    Serial.println("--------------------------------------------------------------");
+}
+
+// --- Private Function Implementations ---
+
+static void recordRun(ExecTimingStats &stats, int64_t start_us, uint32_t elapsed_us, uint32_t response_us, bool has_jitter, int64_t jitter_us)
+{
+    uint32_t jitter_ms = (uint32_t)((jitter_us < 0 ? -jitter_us : jitter_us) / 1000);
+    uint8_t bucket = 0;
+    while (bucket < EXEC_JITTER_BUCKETS - 1 && jitter_ms >= EXEC_JITTER_BUCKET_MS[bucket]) bucket++;
+
+    portENTER_CRITICAL(&exec_timing_mux);
+    if (stats.count == 0 || elapsed_us < stats.min_us) stats.min_us = elapsed_us;
+    if (elapsed_us > stats.max_us) stats.max_us = elapsed_us;
+    stats.total_us += elapsed_us;
+    stats.count++;
+    if (stats.deadline_us != 0 && response_us > stats.deadline_us) stats.deadline_misses++;
+    if (has_jitter) stats.jitter_histogram[bucket]++;
+    stats.last_start_us = start_us;
+    portEXIT_CRITICAL(&exec_timing_mux);
+}
@@ -1,49 +1,221 @@
 // FILE: hal_srne.cpp
 
 #include "hal_srne.h"
+#include "srne_register_map.h"
+#include "crc_utils.h"
+#include "srne_link_stats.h"
+#include "boot_trace.h"
 #include <math.h>
+#include "driver/uart.h"
+#include "esp_timer.h"
 
 // Module-level configurations
-HardwareSerial srne_serial(1);
+const uart_port_t SRNE_UART_PORT = UART_NUM_1;
+const int SRNE_UART_RX_BUFFER = 256;
+const uint8_t SRNE_UART_RX_TIMEOUT_SYMBOLS = 4; // Modbus RTU end of frame: >= 3.5 character times of silence
+static QueueHandle_t srne_uart_events = NULL;
 const uint16_t RETRY_INTERVAL_MS = 100;
 const uint16_t COMMAND_INTERVAL_MS = 150;
 const uint8_t MAX_RETRY = 3;
+const uint8_t MAX_BLOCK_REGISTERS = 32; // Keeps a FC 0x03 reply (5 + 2N bytes) well inside the UART RX FIFO
+
+// Shadow copy of the controller's configuration registers. Refreshed with one block read per range
+// and kept coherent by every successful write, so setters can compare without touching the bus.
+struct ConfigShadowBlock {
+    SrneRegisterBlock range;
+    bool valid;
+    uint16_t values[MAX_BLOCK_REGISTERS];
+};
+static ConfigShadowBlock config_shadow[] = {
+    {SRNE_SETTINGS_BLOCK, false, {0}},
+    {SRNE_LOAD_SETTINGS_BLOCK, false, {0}},
+    {SRNE_LOAD_COMMAND_BLOCK, false, {0}},
+};
+const uint8_t CONFIG_SHADOW_COUNT = sizeof(config_shadow) / sizeof(config_shadow[0]);
+// Setters run from the config task, the scheduler jobs, the threshold monitor and the command
+// handler; every shadow access copies under this lock and never holds it across a transaction.
+// Writes update the shadow on the bus task, in bus order; shadow_writes lets a refresh notice a
+// write that landed while its read was in flight.
+static portMUX_TYPE shadow_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t shadow_writes = 0;
+
+// Bus task: the only code that touches the SRNE UART once setupSrne() has run
+const uint8_t BUS_QUEUE_LENGTH = 8;
+const TickType_t BUS_SUBMIT_TIMEOUT = pdMS_TO_TICKS(1000);
+static TaskHandle_t srne_bus_task = NULL;
+static QueueHandle_t srne_control_queue = NULL;
+static QueueHandle_t srne_telemetry_queue = NULL;
+static TickType_t last_transaction_end = 0;
+
+// Adaptive link timing, one entry per function code (0x03, 0x06, 0x10). The reply timeout is the
+// expected wire time plus the controller's smoothed turnaround and 4x its mean deviation
+// (Jacobson/Karels), so it tracks the real tail latency instead of a fixed guess.
+struct LinkTiming {
+    uint32_t srtt_us;
+    uint32_t rttvar_us;
+    uint8_t consecutive_failures;
+    bool primed;
+};
+static LinkTiming link_timing[3] = {};
+static const uint8_t LINK_FUNCTION_CODES[3] = {0x03, 0x06, 0x10}; // Indexed by SrneOp
+static uint32_t last_response_latency_us = 0; // Of the last srneTransceive(), set on every exit; 0 if nothing was sent
+const uint32_t WIRE_US_PER_BYTE = 1042;          // 10 bits per character at 9600 baud
+const uint32_t LINK_TIMEOUT_DEFAULT_MS = 60;     // Until the first successful sample
+const uint32_t LINK_TIMEOUT_MARGIN_US = 5000;
+const uint32_t LINK_TIMEOUT_MIN_MS = 15;
+const uint32_t LINK_TIMEOUT_MAX_MS = 300;
+const uint16_t MAX_BACKOFF_MS = 1000;
 
 // --- Private (Static) Function Prototypes ---
-static esp_err_t calculateCRC16(const uint8_t *data, size_t length, uint16_t &crc);
-static esp_err_t srneParseData(uint8_t deviceAddress, uint16_t startAddress, uint8_t *pBuffer);
-static esp_err_t srneParseData32(uint8_t deviceAddress, uint16_t startAddress, uint32_t *pBuffer);
-static esp_err_t srneWriteData(uint8_t deviceAddress, uint16_t startAddress, uint16_t value);
+static esp_err_t srneReadRegisters(uint8_t deviceAddress, uint16_t startAddress, uint16_t count, uint16_t *pRegisters, uint32_t time_out_ms);
+static esp_err_t srneWriteData(uint8_t deviceAddress, uint16_t startAddress, uint16_t value, uint32_t time_out_ms);
+static esp_err_t srneWriteRegisters(uint8_t deviceAddress, uint16_t startAddress, uint16_t count, const uint16_t *pValues, uint32_t time_out_ms);
+static esp_err_t srneTransceive(const uint8_t *request, size_t request_len, uint8_t *response, size_t response_size, uint32_t time_out_ms, size_t *received_count);
+static esp_err_t syncRegisterBlock(uint16_t start_address, uint16_t count, const uint16_t *desired, uint32_t managed_mask, uint8_t step_num);
 static esp_err_t readDataWithRetry(uint16_t start_address, uint16_t *value, uint8_t max_retry, uint16_t retry_interval_ms);
-static esp_err_t readDataWithRetry32(uint16_t start_address, uint32_t *value, uint8_t max_retry, uint16_t retry_interval_ms);
+static esp_err_t readBlockWithRetry(uint16_t start_address, uint16_t count, uint16_t *registers, uint8_t max_retry, uint16_t retry_interval_ms);
+static uint32_t registerPairToU32(const uint16_t *registers);
+static void decodeTelemetry(uint16_t start_address, uint16_t count, const uint16_t *registers, batteryDataPack *battery_data, solarDataPack *solar_data, loadDataPack *load_data);
+static esp_err_t readTelemetry(uint16_t start_address, uint16_t count, batteryDataPack *battery_data, solarDataPack *solar_data, loadDataPack *load_data);
+static float estimateSOCFromVoltage(float voltage);
+static bool shadowGet(uint16_t start_address, uint16_t count, uint16_t *values);
+static void shadowPut(uint16_t start_address, uint16_t count, const uint16_t *values);
+static esp_err_t readConfigRegister(uint16_t address, uint16_t *value);
+static uint16_t chargeCurrentRegister(float max_current);
+static void srneBusTask(void *parameter);
+static esp_err_t executeRequest(const SrneRequest &request);
+static uint32_t linkTimeoutMs(SrneOp op, size_t response_len, uint8_t attempt);
+static void linkRecordSuccess(SrneOp op, size_t response_len, uint32_t latency_us);
+static esp_err_t srneTransact(SrneOp op, uint16_t start_address, uint16_t count, uint16_t *values, uint8_t max_retry, uint16_t retry_interval_ms, SrnePriority priority);
 
 // --- Public Function Implementations ---
 
 esp_err_t setupSrne(uint8_t rx_pin, uint8_t tx_pin) {
-    srne_serial.begin(9600, SERIAL_8N1, rx_pin, tx_pin);
+    if (srne_uart_events == NULL) {
+        uart_config_t uart_config = {};
+        uart_config.baud_rate = 9600;
+        uart_config.data_bits = UART_DATA_8_BITS;
+        uart_config.parity = UART_PARITY_DISABLE;
+        uart_config.stop_bits = UART_STOP_BITS_1;
+        uart_config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+        uart_config.source_clk = UART_SCLK_APB;
+        if (uart_driver_install(SRNE_UART_PORT, SRNE_UART_RX_BUFFER, 0, 16, &srne_uart_events, 0) != ESP_OK ||
+            uart_param_config(SRNE_UART_PORT, &uart_config) != ESP_OK ||
+            uart_set_pin(SRNE_UART_PORT, tx_pin, rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK ||
+            uart_set_rx_timeout(SRNE_UART_PORT, SRNE_UART_RX_TIMEOUT_SYMBOLS) != ESP_OK) {
+            Serial.println("❌ Failed to configure SRNE UART.");
+            return ESP_FAIL;
+        }
+    }
     vTaskDelay(pdMS_TO_TICKS(100));
 
+    if (srne_bus_task == NULL) {
+        srne_control_queue = xQueueCreate(BUS_QUEUE_LENGTH, sizeof(SrneRequest));
+        srne_telemetry_queue = xQueueCreate(BUS_QUEUE_LENGTH, sizeof(SrneRequest));
+        if (srne_control_queue == NULL || srne_telemetry_queue == NULL ||
+            xTaskCreatePinnedToCore(srneBusTask, "SrneBusTask", 4096, NULL, 6, &srne_bus_task, 1) != pdPASS) {
+            Serial.println("❌ Failed to start SRNE bus task.");
+            return ESP_FAIL;
+        }
+    }
+
     uint16_t pBuffer = 0;
     if (readDataWithRetry(0x000A, &pBuffer, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) {
         Serial.println("❌ SRNE controller not responding.");
         return ESP_FAIL;
     }
     Serial.println("✅ SRNE controller initialized successfully.");
-    vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
     return ESP_OK;
 }
 
+// Writes are control actions, so they are queued ahead of any pending telemetry reads
 esp_err_t writeDataWithRetry(uint16_t start_address, uint16_t value, uint8_t max_retry, uint16_t retry_interval_ms) {
-    uint8_t attempts = 0;
-    while (attempts < max_retry) {
-        if (srneWriteData(0x01, start_address, value) == ESP_OK) {
-            vTaskDelay(pdMS_TO_TICKS(50));
-            return ESP_OK;
-        }
-        attempts++;
-        vTaskDelay(pdMS_TO_TICKS(retry_interval_ms));
+    if (srneTransact(SrneOp::WRITE_SINGLE, start_address, 1, &value, max_retry, retry_interval_ms, SrnePriority::CONTROL) != ESP_OK) return ESP_FAIL;
+    return ESP_OK;
+}
+
+esp_err_t writeBlockWithRetry(uint16_t start_address, uint16_t count, const uint16_t *values, uint8_t max_retry, uint16_t retry_interval_ms) {
+    if (srneTransact(SrneOp::WRITE_MULTI, start_address, count, (uint16_t *)values, max_retry, retry_interval_ms, SrnePriority::CONTROL) != ESP_OK) return ESP_FAIL;
+    return ESP_OK;
+}
+
+esp_err_t srneSubmitRequest(const SrneRequest &request, SrnePriority priority) {
+    if (srne_bus_task == NULL) return ESP_ERR_INVALID_STATE;
+
+    QueueHandle_t queue = (priority == SrnePriority::CONTROL) ? srne_control_queue : srne_telemetry_queue;
+    if (xQueueSend(queue, &request, BUS_SUBMIT_TIMEOUT) != pdTRUE) return ESP_ERR_TIMEOUT;
+    xTaskNotifyGive(srne_bus_task);
+    return ESP_OK;
+}
+
+esp_err_t refreshConfigShadow() {
+    esp_err_t result = ESP_OK;
+    for (uint8_t i = 0; i < CONFIG_SHADOW_COUNT; i++) {
+        ConfigShadowBlock &block = config_shadow[i];
+        uint16_t values[MAX_BLOCK_REGISTERS];
+        esp_task_wdt_reset();
+
+        portENTER_CRITICAL(&shadow_mux);
+        uint32_t writes_before = shadow_writes;
+        portEXIT_CRITICAL(&shadow_mux);
+
+        bool valid = (readBlockWithRetry(block.range.start, block.range.count, values, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK);
+
+        portENTER_CRITICAL(&shadow_mux);
+        valid = valid && shadow_writes == writes_before; // Otherwise the read may predate that write
+        if (valid) memcpy(block.values, values, block.range.count * sizeof(uint16_t));
+        block.valid = valid;
+        portEXIT_CRITICAL(&shadow_mux);
+        if (!valid) result = ESP_FAIL;
+    }
+    return result;
+}
+
+void invalidateConfigShadow() {
+    portENTER_CRITICAL(&shadow_mux);
+    for (uint8_t i = 0; i < CONFIG_SHADOW_COUNT; i++) {
+        config_shadow[i].valid = false;
+    }
+    portEXIT_CRITICAL(&shadow_mux);
+}
+
+// Brings the controller in line with the desired settings. After one shadow refresh every setter
+// compares against the cached registers, so an already-configured controller costs only the reads.
+esp_err_t reconcileSrneConfig(const chargingProfilePack &profile, const deviceSettingPack &setting, const loadScheduleSettingPack *schedules, uint8_t schedule_amount) {
+    uint8_t step = 1;
+
+    Serial.printf("%d. Refresh Configuration Shadow\n", step++);
+    if (refreshConfigShadow() != ESP_OK) {
+        Serial.println("   -> Shadow incomplete, falling back to direct reads");
     }
-    return ESP_FAIL;
+    bootTraceMark("cfg_shadow");
+
+    Serial.printf("%d. Set Max Charge Current\n", step);
+    if (setMaxChargeCurrent(profile.max_charge_current, step++) != ESP_OK) return ESP_FAIL;
+    bootTraceMark("cfg_charge_current");
+
+    Serial.printf("%d. Set Max Load Current\n", step);
+    if (setMaxLoadCurrent(setting.max_load_current, step++) != ESP_OK) return ESP_FAIL;
+    bootTraceMark("cfg_load_current");
+
+    Serial.printf("%d. Set Light Control Voltage\n", step);
+    if (setLightControlVoltage(setting.voltage_light_control, step++) != ESP_OK) return ESP_FAIL;
+    bootTraceMark("cfg_light_voltage");
+
+    // Manual mode owns 0xDF0A (manual power = 0%), so load_percentage is not pushed here
+    Serial.printf("%d. Set Manual Mode\n", step);
+    if (setManualMode(step++) != ESP_OK) return ESP_FAIL;
+    bootTraceMark("cfg_manual_mode");
+
+    Serial.printf("%d. Set Load Schedules\n", step);
+    if (setLoadSchedules(schedules, schedule_amount, step++) != ESP_OK) return ESP_FAIL;
+    bootTraceMark("cfg_schedules");
+
+    Serial.printf("%d. Set Lithium Battery Parameters\n", step);
+    if (setLithiumBattery(setting, step++) != ESP_OK) return ESP_FAIL;
+    bootTraceMark("cfg_lithium");
+
+    return ESP_OK;
 }
 
 // +++ START: เพิ่มฟังก์ชันใหม่ที่นี่ +++
@@ -52,7 +224,7 @@ esp_err_t setLightControlVoltage(float voltage, uint8_t step_num) {
     uint16_t new_value = (uint16_t)round(voltage); // Multiplier is 1
     uint16_t current_value;
 
-    if (readDataWithRetry(address, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
+    if (readConfigRegister(address, &current_value) == ESP_OK) {
         if (step_num != 0) Serial.printf("  [CHECK] Comparing Light Control Voltage: Current value = %d, New value = %d\n", current_value, new_value);
         if (current_value == new_value) {
             if (step_num != 0) Serial.printf("  %d.1 Light Control Voltage is already set to %.1fV. Skipping write.\n", step_num, voltage);
@@ -68,257 +240,62 @@ esp_err_t setLightControlVoltage(float voltage, uint8_t step_num) {
 // +++ END: เพิ่มฟังก์ชันใหม่ที่นี่ +++
 
 esp_err_t setManualLoadPowerWithDuration(uint8_t power, uint16_t duration_s) {
-    const uint8_t deviceAddress = 0x01;
-    const uint16_t startAddress = 0xDF0A;
-    const uint16_t numRegisters = 2;
-    const uint8_t byteCount = 4;
-
-    uint8_t frame[13];
-    
-    uint8_t payload[4];
-    payload[0] = 0x00;
-    payload[1] = power;
-    payload[2] = (duration_s >> 8) & 0xFF;
-    payload[3] = duration_s & 0xFF;
-
-    frame[0] = deviceAddress;
-    frame[1] = 0x10; // Function Code: Write Multiple Registers
-    frame[2] = (startAddress >> 8) & 0xFF;
-    frame[3] = startAddress & 0xFF;
-    frame[4] = (numRegisters >> 8) & 0xFF;
-    frame[5] = numRegisters & 0xFF;
-    frame[6] = byteCount;
-    memcpy(&frame[7], payload, byteCount);
-
-    uint16_t crc;
-    calculateCRC16(frame, 11, crc);
-    frame[11] = crc & 0xFF;
-    frame[12] = (crc >> 8) & 0xFF;
-
-    while(srne_serial.available()) srne_serial.read();
-    srne_serial.write(frame, sizeof(frame));
-    srne_serial.flush();
-
-    uint8_t response[8];
-    srne_serial.setTimeout(100);
-    size_t received_count = srne_serial.readBytes(response, sizeof(response));
-
-    if (received_count < sizeof(response)) {
-        return ESP_ERR_TIMEOUT;
-    }
-    
-    return ESP_OK;
+    // 0xDF0A: manual load power (%), 0xDF0B: duration (s)
+    const uint16_t values[2] = {power, duration_s};
+    return writeBlockWithRetry(0xDF0A, 2, values, 1, RETRY_INTERVAL_MS);
 }
 
 esp_err_t setLoadSchedules(const loadScheduleSettingPack *schedules, uint8_t schedule_amount, uint8_t step_num) {
+    // Schedule n occupies 3 registers at 0xE092 + (n - 1) * 3: duration, attended power, unattended power
     const uint16_t first_schedule_register = 0xE092;
-    uint16_t current_value;
-    uint16_t new_value;
+    const uint16_t register_count = SCHEDULE_SLOT_COUNT * 3;
+    uint16_t desired[register_count] = {0};
+    uint32_t managed_mask = 0;
 
     for (uint8_t i = 0; i < schedule_amount; i++)
     {
-        esp_task_wdt_reset();
         uint8_t schedule_no = schedules[i].schedule_no;
-        uint16_t base_address = first_schedule_register + (schedule_no - 1) * 3;
+        if (schedule_no < 1 || schedule_no > SCHEDULE_SLOT_COUNT) continue;
 
-        if (step_num != 0) {
-             Serial.printf("--- Checking Schedule %d (Slot %d) ---\n", i + 1, schedules[i].schedule_no);
-        }
-
-        // --- 1) Duration ---
-        uint16_t duration_address = base_address;
-        new_value = schedules[i].duration_s;
-        if (readDataWithRetry(duration_address, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-            if (step_num != 0) Serial.printf("    [CHECK] Comparing Duration: Current value = %d, New value = %d\n", current_value, new_value);
-            if(current_value == new_value) {
-                if (step_num != 0) Serial.printf("    -> Value is already %us. Skipping.\n", new_value);
-            } else {
-                if (step_num != 0) Serial.printf("    -> Writing new value: %us\n", new_value);
-                if (writeDataWithRetry(duration_address, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-            }
-        } else {
-            if (step_num != 0) Serial.printf("    -> Failed to read Duration. Writing new value %d\n", new_value);
-            if (writeDataWithRetry(duration_address, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-        }
-        vTaskDelay(pdMS_TO_TICKS(1000));
-
-        // --- 2) Attended power ---
-        uint16_t attended_address = base_address + 1;
-        new_value = schedules[i].attended_power;
-        if (readDataWithRetry(attended_address, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-            if (step_num != 0) Serial.printf("    [CHECK] Comparing Attended Power: Current value = %d, New value = %d\n", current_value, new_value);
-            if (current_value == new_value) {
-                if (step_num != 0) Serial.printf("    -> Value is already %d%%. Skipping.\n", new_value);
-            } else {
-                if (step_num != 0) Serial.printf("    -> Writing new value: %d%%\n", new_value);
-                if (writeDataWithRetry(attended_address, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-            }
-        } else {
-            if (step_num != 0) Serial.printf("    -> Failed to read Attended Power. Writing new value %d\n", new_value);
-            if (writeDataWithRetry(attended_address, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-        }
-        vTaskDelay(pdMS_TO_TICKS(1000));
-
-        // --- 3) Unattended power ---
-        uint16_t unattended_address = base_address + 2;
-        new_value = schedules[i].unattended_power;
-        if (readDataWithRetry(unattended_address, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-            if (step_num != 0) Serial.printf("    [CHECK] Comparing Unattended Power: Current value = %d, New value = %d\n", current_value, new_value);
-            if (current_value == new_value) {
-                 if (step_num != 0) Serial.printf("    -> Value is already %d%%. Skipping.\n", new_value);
-            } else {
-                if (step_num != 0) Serial.printf("    -> Writing new value: %d%%\n", new_value);
-                if (writeDataWithRetry(unattended_address, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-            }
-        } else {
-            if (step_num != 0) Serial.printf("    -> Failed to read Unattended power. Writing new value %d\n", new_value);
-            if (writeDataWithRetry(unattended_address, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-        }
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        uint16_t offset = (schedule_no - 1) * 3;
+        desired[offset] = schedules[i].duration_s;
+        desired[offset + 1] = schedules[i].attended_power;
+        desired[offset + 2] = schedules[i].unattended_power;
+        managed_mask |= 0x7UL << offset;
     }
 
-    return ESP_OK;
+    return syncRegisterBlock(first_schedule_register, register_count, desired, managed_mask, step_num);
 }
 
 esp_err_t setLithiumBattery(const deviceSettingPack &setting, uint8_t step_num) {
-    uint8_t sub_step = 1;
-    uint16_t current_value;
-    uint16_t new_value;
-
-    // --- 1. System Voltage ---
-    if (step_num != 0) Serial.printf("  %d.%d Checking System Voltage...\n", step_num, sub_step);
-    new_value = setting.voltage_system;
-    if (readDataWithRetry(0xE003, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-        if (step_num != 0) Serial.printf("    [CHECK] Comparing: Current value = %d, New value = %d\n", current_value, new_value);
-        if (current_value == new_value) {
-            if (step_num != 0) Serial.printf("    -> Value is already %dV. Skipping.\n", setting.voltage_system);
-        } else {
-            if (step_num != 0) Serial.printf("    -> Writing new value: %dV\n", setting.voltage_system);
-            if (writeDataWithRetry(0xE003, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-        }
-    } else {
-        if (step_num != 0) Serial.printf("    -> Failed to read. Writing new value: %dV\n", setting.voltage_system);
-        if (writeDataWithRetry(0xE003, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-    }
-    sub_step++;
-    vTaskDelay(pdMS_TO_TICKS(1000));
-
-    // --- 2. Overcharge Voltage ---
-    if (step_num != 0) Serial.printf("  %d.%d Checking Overcharge Voltage...\n", step_num, sub_step);
-    new_value = round(setting.over_charge_voltage * 10.0f);
-    if (readDataWithRetry(0xE008, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-        if (step_num != 0) Serial.printf("    [CHECK] Comparing: Current value = %d, New value = %d\n", current_value, new_value);
-        if (current_value == new_value) {
-            if (step_num != 0) Serial.printf("    -> Value is already %.1fV. Skipping.\n", setting.over_charge_voltage);
-        } else {
-            if (step_num != 0) Serial.printf("    -> Writing new value: %.1fV\n", setting.over_charge_voltage);
-            if (writeDataWithRetry(0xE008, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-        }
-    } else {
-        if (step_num != 0) Serial.printf("    -> Failed to read. Writing new value: %.1fV\n", setting.over_charge_voltage);
-        if (writeDataWithRetry(0xE008, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-    }
-    sub_step++;
-    vTaskDelay(pdMS_TO_TICKS(1000));
-
-    // --- 3. Overcharge Return Voltage ---
-    if (step_num != 0) Serial.printf("  %d.%d Checking Overcharge Return Voltage...\n", step_num, sub_step);
-    new_value = round(setting.over_charge_return_voltage * 10.0f);
-    if (readDataWithRetry(0xE009, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-        if (step_num != 0) Serial.printf("    [CHECK] Comparing: Current value = %d, New value = %d\n", current_value, new_value);
-        if (current_value == new_value) {
-            if (step_num != 0) Serial.printf("    -> Value is already %.1fV. Skipping.\n", setting.over_charge_return_voltage);
-        } else {
-            if (step_num != 0) Serial.printf("    -> Writing new value: %.1fV\n", setting.over_charge_return_voltage);
-            if (writeDataWithRetry(0xE009, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-        }
-    } else {
-        if (step_num != 0) Serial.printf("    -> Failed to read. Writing new value: %.1fV\n", setting.over_charge_return_voltage);
-        if (writeDataWithRetry(0xE009, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-    }
-    sub_step++;
-    vTaskDelay(pdMS_TO_TICKS(1000));
-    
-    // --- 4. Over-discharge Voltage ---
-    if (step_num != 0) Serial.printf("  %d.%d Checking Over-discharge Voltage...\n", step_num, sub_step);
-    new_value = round(setting.over_discharge_voltage * 10.0f);
-    if (readDataWithRetry(0xE00D, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-        if (step_num != 0) Serial.printf("    [CHECK] Comparing: Current value = %d, New value = %d\n", current_value, new_value);
-        if (current_value == new_value) {
-            if (step_num != 0) Serial.printf("    -> Value is already %.1fV. Skipping.\n", setting.over_discharge_voltage);
-        } else {
-            if (step_num != 0) Serial.printf("    -> Writing new value: %.1fV\n", setting.over_discharge_voltage);
-            if (writeDataWithRetry(0xE00D, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-        }
-    } else {
-        if (step_num != 0) Serial.printf("    -> Failed to read. Writing new value: %.1fV\n", setting.over_discharge_voltage);
-        if (writeDataWithRetry(0xE00D, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-    }
-    sub_step++;
-    vTaskDelay(pdMS_TO_TICKS(1000));
-
-    // --- 5. Over-discharge Return Voltage ---
-    if (step_num != 0) Serial.printf("  %d.%d Checking Over-discharge Return Voltage...\n", step_num, sub_step);
-    new_value = round(setting.over_discharge_return_voltage * 10.0f);
-    if (readDataWithRetry(0xE00B, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-        if (step_num != 0) Serial.printf("    [CHECK] Comparing: Current value = %d, New value = %d\n", current_value, new_value);
-        if (current_value == new_value) {
-            if (step_num != 0) Serial.printf("    -> Value is already %.1fV. Skipping.\n", setting.over_discharge_return_voltage);
-        } else {
-            if (step_num != 0) Serial.printf("    -> Writing new value: %.1fV\n", setting.over_discharge_return_voltage);
-            if (writeDataWithRetry(0xE00B, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-        }
-    } else {
-        if (step_num != 0) Serial.printf("    -> Failed to read. Writing new value: %.1fV\n", setting.over_discharge_return_voltage);
-        if (writeDataWithRetry(0xE00B, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-    }
-    sub_step++;
-    vTaskDelay(pdMS_TO_TICKS(1000));
-    
-    // --- 6. Nominal Capacity ---
-    if (step_num != 0) Serial.printf("  %d.%d Checking Nominal Capacity...\n", step_num, sub_step);
-    new_value = setting.nominal_capacity;
-    if (readDataWithRetry(0xE002, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-        if (step_num != 0) Serial.printf("    [CHECK] Comparing: Current value = %d, New value = %d\n", current_value, new_value);
-        if (current_value == new_value) {
-            if (step_num != 0) Serial.printf("    -> Value is already %dAH. Skipping.\n", setting.nominal_capacity);
-        } else {
-            if (step_num != 0) Serial.printf("    -> Writing new value: %dAH\n", setting.nominal_capacity);
-            if (writeDataWithRetry(0xE002, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-        }
-    } else {
-        if (step_num != 0) Serial.printf("    -> Failed to read. Writing new value: %dAH\n", setting.nominal_capacity);
-        if (writeDataWithRetry(0xE002, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-    }
-    sub_step++;
-    vTaskDelay(pdMS_TO_TICKS(1000));
-
-    // --- 7. Battery Type ---
-    if (step_num != 0) Serial.printf("  %d.%d Checking Battery Type...\n", step_num, sub_step);
-    new_value = 0x0011; // Lithium
-    if (readDataWithRetry(0xE004, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-        if (step_num != 0) Serial.printf("    [CHECK] Comparing: Current value = %d, New value = %d\n", current_value, new_value);
-        if (current_value == new_value) {
-            if (step_num != 0) Serial.printf("    -> Value is already Lithium (0x11). Skipping.\n");
-        } else {
-            if (step_num != 0) Serial.printf("    -> Writing new value: Lithium (0x11)\n");
-            if (writeDataWithRetry(0xE004, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-        }
-    } else {
-        if (step_num != 0) Serial.printf("    -> Failed to read. Writing new value: Lithium (0x11)\n");
-        if (writeDataWithRetry(0xE004, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-    }
-    
-    return ESP_OK;
+    // Battery parameter block 0xE002-0xE00D; only the registers below are managed, the rest are preserved
+    const uint16_t first_register = 0xE002;
+    const uint16_t register_count = 12;
+    uint16_t desired[register_count] = {0};
+    uint32_t managed_mask = 0;
+
+    auto manage = [&](uint16_t address, uint16_t value) {
+        desired[address - first_register] = value;
+        managed_mask |= 1UL << (address - first_register);
+    };
+    manage(0xE002, setting.nominal_capacity);
+    manage(0xE003, setting.voltage_system);
+    manage(0xE004, 0x0011); // Lithium
+    manage(0xE008, round(setting.over_charge_voltage * 10.0f));
+    manage(0xE009, round(setting.over_charge_return_voltage * 10.0f));
+    manage(0xE00B, round(setting.over_discharge_return_voltage * 10.0f));
+    manage(0xE00D, round(setting.over_discharge_voltage * 10.0f));
+
+    return syncRegisterBlock(first_register, register_count, desired, managed_mask, step_num);
 }
 
 esp_err_t setMaxChargeCurrent(float max_current, uint8_t step_num) {
     const uint16_t address = 0xE001;
     float set_current = (max_current > 3.85) ? 3.85 : max_current;
-    uint16_t new_value = round(set_current * 100.0f);
+    uint16_t new_value = chargeCurrentRegister(max_current);
     uint16_t current_value;
 
-    if (readDataWithRetry(address, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
+    if (readConfigRegister(address, &current_value) == ESP_OK) {
         if (step_num != 0) Serial.printf("  [CHECK] Comparing MaxChargeCurrent: Current value = %d, New value = %d\n", current_value, new_value);
         if (current_value == new_value) {
             if (step_num != 0) Serial.printf("  %d.1 Max Charge Current is already set to %.2fA. Skipping write.\n", step_num, set_current);
@@ -332,12 +309,19 @@ esp_err_t setMaxChargeCurrent(float max_current, uint8_t step_num) {
     return writeDataWithRetry(address, new_value, MAX_RETRY, RETRY_INTERVAL_MS);
 }
 
+// Protection path: always writes, at control priority. The shadow is not consulted because the
+// keypad, the BT app or a controller reset can change 0xE001 without the firmware seeing it, and
+// a cap that is never sent is worse than one FC 0x06 per trip or release.
+esp_err_t limitMaxChargeCurrent(float max_current) {
+    return writeDataWithRetry(0xE001, chargeCurrentRegister(max_current), MAX_RETRY, RETRY_INTERVAL_MS);
+}
+
 esp_err_t setMaxLoadCurrent(float max_current, uint8_t step_num) {
     const uint16_t address = 0xE08D;
     uint16_t new_value = round(max_current * 100.0f);
     uint16_t current_value;
 
-    if (readDataWithRetry(address, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
+    if (readConfigRegister(address, &current_value) == ESP_OK) {
         if (step_num != 0) Serial.printf("  [CHECK] Comparing MaxLoadCurrent: Current value = %d, New value = %d\n", current_value, new_value);
         if (current_value == new_value) {
             if (step_num != 0) Serial.printf("  %d.1 Max Load Current is already set to %.2fA. Skipping write.\n", step_num, max_current);
@@ -351,85 +335,15 @@ esp_err_t setMaxLoadCurrent(float max_current, uint8_t step_num) {
     return writeDataWithRetry(address, new_value, MAX_RETRY, RETRY_INTERVAL_MS);
 }
 
-esp_err_t setLoadPercentage(uint8_t percentage, uint8_t step_num) {
-    const uint16_t address = 0xDF0A;
-    uint16_t new_value = percentage;
-    uint16_t current_value;
-
-    if (readDataWithRetry(address, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-        if (step_num != 0) Serial.printf("  [CHECK] Comparing Load Percentage: Current value = %d, New value = %d\n", current_value, new_value);
-        if (current_value == new_value) {
-            if (step_num != 0) Serial.printf("  %d.1 Load Percentage is already set to %d%%. Skipping write.\n", step_num, percentage);
-            return ESP_OK;
-        }
-    } else {
-        if (step_num != 0) Serial.printf("  [CHECK] Failed to read Load Percentage. Proceeding to write.\n");
-    }
-
-    if (step_num != 0) Serial.printf("  %d.1 Writing Load Percentage for Manual/Test Mode: %d%% to address 0xDF0A\n", step_num, percentage);
-    return writeDataWithRetry(address, new_value, MAX_RETRY, RETRY_INTERVAL_MS);
-}
-
 esp_err_t setManualMode(uint8_t step_num) {
-    uint8_t sub_step = 1;
-    uint16_t current_value;
-    uint16_t new_value;
-
-    // 1. Set Load Operation Mode to Manual (0x0200)
-    if (step_num != 0) Serial.printf("  %d.%d Checking Load Operation Mode...\n", step_num, sub_step);
-    new_value = 0x0200;
-    if (readDataWithRetry(0xDF09, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-        if (step_num != 0) Serial.printf("    [CHECK] Comparing: Current value = %d, New value = %d\n", current_value, new_value);
-        if (current_value == new_value) {
-            if (step_num != 0) Serial.printf("    -> Value is already Manual. Skipping.\n");
-        } else {
-             if (step_num != 0) Serial.printf("    -> Writing new value: Manual (0x0200)\n");
-             if (writeDataWithRetry(0xDF09, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-        }
-    } else {
-        if (step_num != 0) Serial.printf("    -> Failed to read. Writing new value: Manual (0x0200)\n");
-        if (writeDataWithRetry(0xDF09, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-    }
-    sub_step++;
-    
-    // 2. Set Manual Power to 0%
-    if (step_num != 0) Serial.printf("  %d.%d Checking Manual Power...\n", step_num, sub_step);
-    new_value = 0x0000;
-    if (readDataWithRetry(0xDF0A, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-        if (step_num != 0) Serial.printf("    [CHECK] Comparing: Current value = %d, New value = %d\n", current_value, new_value);
-        if (current_value == new_value) {
-            if (step_num != 0) Serial.printf("    -> Value is already 0%%. Skipping.\n");
-        } else {
-            if (step_num != 0) Serial.printf("    -> Writing new value: 0%%\n");
-            if (writeDataWithRetry(0xDF0A, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-        }
-    } else {
-        if (step_num != 0) Serial.printf("    -> Failed to read. Writing new value: 0%%\n");
-        if (writeDataWithRetry(0xDF0A, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-    }
-    sub_step++;
-
-    // 3. Set Manual Duration
-    if (step_num != 0) Serial.printf("  %d.%d Checking Manual Duration...\n", step_num, sub_step);
-    new_value = 0xD2F0;
-    if (readDataWithRetry(0xDF0B, &current_value, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-        if (step_num != 0) Serial.printf("    [CHECK] Comparing: Current value = %d, New value = %d\n", current_value, new_value);
-        if (current_value == new_value) {
-            if (step_num != 0) Serial.printf("    -> Value is already 0xD2F0. Skipping.\n");
-        } else {
-            if (step_num != 0) Serial.printf("    -> Writing new value: 0xD2F0\n");
-            if (writeDataWithRetry(0xDF0B, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-        }
-    } else {
-        if (step_num != 0) Serial.printf("    -> Failed to read. Writing new value: 0xD2F0\n");
-        if (writeDataWithRetry(0xDF0B, new_value, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-    }
-    
-    return ESP_OK;
+    // 0xDF09: load operation mode = Manual (0x0200), 0xDF0A: manual power = 0%, 0xDF0B: manual duration
+    const uint16_t desired[3] = {0x0200, 0x0000, 0xD2F0};
+    return syncRegisterBlock(0xDF09, 3, desired, 0x7, step_num);
 }
 
 esp_err_t factoryReset() {
     bool success = true;
+    invalidateConfigShadow();
     if (writeDataWithRetry(0xDF02, 0x0001, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) success = false;
     vTaskDelay(pdMS_TO_TICKS(1000));
     if (writeDataWithRetry(0xDF05, 0x0001, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) success = false;
@@ -438,36 +352,15 @@ esp_err_t factoryReset() {
     vTaskDelay(pdMS_TO_TICKS(1000));
     return success ? ESP_OK : ESP_FAIL;
 }
-esp_err_t getLoadInfo(loadDataPack *ld) {
-    uint16_t buffer;
-    if (readDataWithRetry(0x0104, &buffer, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) ld->load_voltage = buffer * 0.1; else return ESP_FAIL;
-    vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
-    if (readDataWithRetry(0x0105, &buffer, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) ld->load_current = buffer * 0.01; else return ESP_FAIL;
-    vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
-    if (readDataWithRetry(0x0106, &buffer, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) ld->load_power = buffer; else return ESP_FAIL;
-    vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
-    return ESP_OK;
-}
-esp_err_t getSolarInfo(solarDataPack *solar_data) {
-    uint16_t buffer;
-    if (readDataWithRetry(0x0107, &buffer, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) solar_data->solar_voltage = buffer * 0.1; else return ESP_FAIL;
-    vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
-    if (readDataWithRetry(0x0108, &buffer, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) solar_data->solar_current = buffer * 0.01; else return ESP_FAIL;
-    vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
-    if (readDataWithRetry(0x0109, &buffer, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) solar_data->solar_power = buffer; else return ESP_FAIL;
-    vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
-    return ESP_OK;
-}
-esp_err_t getBatteryInfo(batteryDataPack *battery_data) {
-    uint16_t buffer;
-    if (readDataWithRetry(0x0100, &buffer, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) battery_data->battery_soc = buffer; else return ESP_FAIL;
-    vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
-    if (readDataWithRetry(0x0101, &buffer, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) battery_data->battery_voltage = buffer * 0.1; else return ESP_FAIL;
-    vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
-    if (readDataWithRetry(0x0102, &buffer, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) battery_data->battery_current = buffer * 0.01; else return ESP_FAIL;
-    vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
-    if (readDataWithRetry(0x0103, &buffer, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) battery_data->battery_temperature = (int8_t)(buffer & 0xFF); else return ESP_FAIL;
-    vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
+
+// Reads the whole real-time block (0x0100-0x0109) and the accumulators (0x0118-0x011F)
+// in two transactions, so every field of one snapshot is sampled at the same moment.
+esp_err_t getRealtimeInfo(batteryDataPack *battery_data, solarDataPack *solar_data, loadDataPack *load_data) {
+    esp_task_wdt_reset();
+    if (readTelemetry(SRNE_REALTIME_BLOCK.start, SRNE_REALTIME_BLOCK.count, battery_data, solar_data, load_data) != ESP_OK) return ESP_FAIL;
+    if (readTelemetry(SRNE_TOTALS_BLOCK.start, SRNE_TOTALS_BLOCK.count, battery_data, solar_data, load_data) != ESP_OK) return ESP_FAIL;
+
+    battery_data->battery_soc_estimated = estimateSOCFromVoltage(battery_data->battery_voltage);
     return ESP_OK;
 }
 
@@ -489,170 +382,342 @@ const VoltageSOCTable soc_lookup_table[] = {
 };
 const int soc_table_size = sizeof(soc_lookup_table) / sizeof(soc_lookup_table[0]);
 
-esp_err_t updateEstimatedSOC(batteryDataPack *battery_data) {
-    uint16_t buffer;
-    esp_task_wdt_reset();
-    if (readDataWithRetry(0x0101, &buffer, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) {
-        return ESP_FAIL;
+static float estimateSOCFromVoltage(float voltage) {
+    if (voltage <= soc_lookup_table[0].voltage) {
+        return soc_lookup_table[0].soc;
+    }
+    if (voltage >= soc_lookup_table[soc_table_size - 1].voltage) {
+        return soc_lookup_table[soc_table_size - 1].soc;
+    }
+    for (int i = 0; i < soc_table_size - 1; i++) {
+        if (voltage >= soc_lookup_table[i].voltage && voltage < soc_lookup_table[i+1].voltage) {
+            float v1 = soc_lookup_table[i].voltage;
+            float s1 = soc_lookup_table[i].soc;
+            float v2 = soc_lookup_table[i+1].voltage;
+            float s2 = soc_lookup_table[i+1].soc;
+            return s1 + ((voltage - v1) * (s2 - s1)) / (v2 - v1);
+        }
     }
+    return 0.0f;
+}
 
-    float voltage = buffer * 0.1f;
-    float estimated_soc = 0.0f;
+esp_err_t clearAccumulateData() {
+    return writeDataWithRetry(0xDF05, 1, MAX_RETRY, RETRY_INTERVAL_MS);
+}
 
-    if (voltage <= soc_lookup_table[0].voltage) {
-        estimated_soc = soc_lookup_table[0].soc;
-    } else if (voltage >= soc_lookup_table[soc_table_size - 1].voltage) {
-        estimated_soc = soc_lookup_table[soc_table_size - 1].soc;
-    } else {
-        for (int i = 0; i < soc_table_size - 1; i++) {
-            if (voltage >= soc_lookup_table[i].voltage && voltage < soc_lookup_table[i+1].voltage) {
-                float v1 = soc_lookup_table[i].voltage;
-                float s1 = soc_lookup_table[i].soc;
-                float v2 = soc_lookup_table[i+1].voltage;
-                float s2 = soc_lookup_table[i+1].soc;
-                estimated_soc = s1 + ((voltage - v1) * (s2 - s1)) / (v2 - v1);
-                break;
+static bool shadowGet(uint16_t start_address, uint16_t count, uint16_t *values) {
+    bool found = false;
+    portENTER_CRITICAL(&shadow_mux);
+    for (uint8_t i = 0; i < CONFIG_SHADOW_COUNT; i++) {
+        const ConfigShadowBlock &block = config_shadow[i];
+        if (!block.valid || start_address < block.range.start || start_address + count > block.range.start + block.range.count) continue;
+        memcpy(values, &block.values[start_address - block.range.start], count * sizeof(uint16_t));
+        found = true;
+        break;
+    }
+    portEXIT_CRITICAL(&shadow_mux);
+    return found;
+}
+// Bus task only, after a successful write
+static void shadowPut(uint16_t start_address, uint16_t count, const uint16_t *values) {
+    portENTER_CRITICAL(&shadow_mux);
+    shadow_writes++;
+    for (uint8_t i = 0; i < CONFIG_SHADOW_COUNT; i++) {
+        ConfigShadowBlock &block = config_shadow[i];
+        if (!block.valid) continue;
+        for (uint16_t j = 0; j < count; j++) {
+            uint16_t address = start_address + j;
+            if (address >= block.range.start && address < block.range.start + block.range.count) {
+                block.values[address - block.range.start] = values[j];
             }
         }
     }
+    portEXIT_CRITICAL(&shadow_mux);
+}
+static uint16_t chargeCurrentRegister(float max_current) {
+    float set_current = (max_current > 3.85) ? 3.85 : max_current;
+    return round(set_current * 100.0f);
+}
+static esp_err_t readConfigRegister(uint16_t address, uint16_t *value) {
+    if (shadowGet(address, 1, value)) return ESP_OK;
+    return readDataWithRetry(address, value, MAX_RETRY, RETRY_INTERVAL_MS);
+}
+static esp_err_t readDataWithRetry(uint16_t start_address, uint16_t *value, uint8_t max_retry, uint16_t retry_interval_ms) {
+    return readBlockWithRetry(start_address, 1, value, max_retry, retry_interval_ms);
+}
+static esp_err_t readBlockWithRetry(uint16_t start_address, uint16_t count, uint16_t *registers, uint8_t max_retry, uint16_t retry_interval_ms) {
+    return srneTransact(SrneOp::READ, start_address, count, registers, max_retry, retry_interval_ms, SrnePriority::TELEMETRY);
+}
 
-    battery_data->battery_soc_estimated = estimated_soc;
-    battery_data->battery_voltage = voltage;
+struct SyncCompletion {
+    SemaphoreHandle_t done;
+    esp_err_t result;
+};
+static void completeSync(esp_err_t result, void *context) {
+    SyncCompletion *completion = (SyncCompletion *)context;
+    completion->result = result;
+    xSemaphoreGive(completion->done);
+}
+// Blocking front end used by every HAL function: queue the request and sleep until the bus task
+// has served it. Runs the transaction inline when called from the task itself. Fails without
+// touching the bus until setupSrne() has installed the UART and started the task.
+static esp_err_t srneTransact(SrneOp op, uint16_t start_address, uint16_t count, uint16_t *values, uint8_t max_retry, uint16_t retry_interval_ms, SrnePriority priority) {
+    SrneRequest request = {};
+    request.op = op;
+    request.start_address = start_address;
+    request.count = count;
+    request.values = values;
+    request.max_retry = max_retry;
+    request.retry_interval_ms = retry_interval_ms;
+
+    if (srne_bus_task == NULL) return ESP_ERR_INVALID_STATE;
+    if (xTaskGetCurrentTaskHandle() == srne_bus_task) {
+        return executeRequest(request);
+    }
 
-    return ESP_OK;
+    StaticSemaphore_t done_buffer;
+    SyncCompletion completion = {xSemaphoreCreateBinaryStatic(&done_buffer), ESP_FAIL};
+    request.callback = completeSync;
+    request.context = &completion;
+
+    esp_err_t err = srneSubmitRequest(request, priority);
+    if (err == ESP_OK) {
+        xSemaphoreTake(completion.done, portMAX_DELAY);
+        err = completion.result;
+    }
+    vSemaphoreDelete(completion.done);
+    return err;
 }
+static esp_err_t executeRequest(const SrneRequest &request) {
+    // Keep the controller's inter-command gap, counting time the caller already spent elsewhere
+    TickType_t since_last = xTaskGetTickCount() - last_transaction_end;
+    if (since_last < pdMS_TO_TICKS(COMMAND_INTERVAL_MS)) {
+        vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS) - since_last);
+    }
 
-esp_err_t getLoadWh(loadDataPack *load_data) {
-    uint32_t pBuffer = 0;
-    if (readDataWithRetry32(0x011E, &pBuffer, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-        load_data->load_wh = pBuffer;
-    } else return ESP_FAIL;
-    vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
-    return ESP_OK;
+    LinkTiming &timing = link_timing[(uint8_t)request.op];
+    const size_t response_len = (request.op == SrneOp::READ) ? 5 + request.count * 2 : 8;
+    esp_err_t result = ESP_FAIL;
+    for (uint8_t attempts = 0; attempts < request.max_retry; attempts++) {
+        uint32_t time_out_ms = linkTimeoutMs(request.op, response_len, attempts);
+        switch (request.op) {
+            case SrneOp::READ:         result = srneReadRegisters(0x01, request.start_address, request.count, request.values, time_out_ms); break;
+            case SrneOp::WRITE_SINGLE: result = srneWriteData(0x01, request.start_address, request.values[0], time_out_ms); break;
+            case SrneOp::WRITE_MULTI:  result = srneWriteRegisters(0x01, request.start_address, request.count, request.values, time_out_ms); break;
+        }
+        // A failed attempt's latency measures the timeout or a garbled frame, not the controller:
+        // neither the histogram nor the RTT estimator sees it
+        uint32_t latency_us = (result == ESP_OK) ? last_response_latency_us : 0;
+        srneLinkRecordAttempt(LINK_FUNCTION_CODES[(uint8_t)request.op], request.start_address, result, latency_us, attempts > 0);
+        if (result == ESP_OK) {
+            linkRecordSuccess(request.op, response_len, latency_us);
+            if (request.op != SrneOp::READ) shadowPut(request.start_address, request.count, request.values);
+            break;
+        }
+
+        // Exponential backoff that keeps growing while the link stays bad and resets on success
+        if (timing.consecutive_failures < 255) timing.consecutive_failures++;
+        uint8_t shift = (timing.consecutive_failures > 4) ? 4 : timing.consecutive_failures - 1;
+        uint32_t backoff_ms = (uint32_t)request.retry_interval_ms << shift;
+        if (attempts + 1 < request.max_retry) vTaskDelay(pdMS_TO_TICKS(backoff_ms > MAX_BACKOFF_MS ? MAX_BACKOFF_MS : backoff_ms));
+    }
+
+    last_transaction_end = xTaskGetTickCount();
+    return (result == ESP_OK) ? ESP_OK : ESP_FAIL;
 }
-esp_err_t getChargeWh(batteryDataPack *battery_data) {
-    uint32_t pBuffer = 0;
-    if (readDataWithRetry32(0x011C, &pBuffer, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-        battery_data->charge_wh = pBuffer;
-    } else return ESP_FAIL;
-    vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
-    return ESP_OK;
+static uint32_t linkTimeoutMs(SrneOp op, size_t response_len, uint8_t attempt) {
+    const LinkTiming &timing = link_timing[(uint8_t)op];
+    uint32_t wire_us = response_len * WIRE_US_PER_BYTE;
+    uint32_t timeout_us = timing.primed
+        ? wire_us + timing.srtt_us + 4 * timing.rttvar_us + LINK_TIMEOUT_MARGIN_US
+        : wire_us + LINK_TIMEOUT_DEFAULT_MS * 1000;
+    timeout_us <<= (attempt > 2) ? 2 : attempt; // A timed-out attempt waits longer on the next try
+
+    uint32_t timeout_ms = (timeout_us + 999) / 1000;
+    if (timeout_ms < LINK_TIMEOUT_MIN_MS) return LINK_TIMEOUT_MIN_MS;
+    if (timeout_ms > LINK_TIMEOUT_MAX_MS) return LINK_TIMEOUT_MAX_MS;
+    return timeout_ms;
 }
-esp_err_t clearAccumulateData() {
-    if (writeDataWithRetry(0xDF05, 1, MAX_RETRY, RETRY_INTERVAL_MS) == ESP_OK) {
-        vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
-        return ESP_OK;
+static void linkRecordSuccess(SrneOp op, size_t response_len, uint32_t latency_us) {
+    LinkTiming &timing = link_timing[(uint8_t)op];
+    uint32_t wire_us = response_len * WIRE_US_PER_BYTE;
+    uint32_t turnaround_us = (latency_us > wire_us) ? latency_us - wire_us : 0;
+
+    if (!timing.primed) {
+        timing.srtt_us = turnaround_us;
+        timing.rttvar_us = turnaround_us / 2;
+        timing.primed = true;
+    } else {
+        uint32_t deviation = (timing.srtt_us > turnaround_us) ? timing.srtt_us - turnaround_us : turnaround_us - timing.srtt_us;
+        timing.rttvar_us = (3 * timing.rttvar_us + deviation) / 4;
+        timing.srtt_us = (7 * timing.srtt_us + turnaround_us) / 8;
     }
-    return ESP_FAIL;
-}
-// +++ START: เพิ่มฟังก์ชันใหม่ +++
-esp_err_t get_energy(batteryDataPack *battery_data) {
-    uint32_t buffer;
-    
-    // Read 0x0118: Total charge ampere hour of battery
-    if (readDataWithRetry32(0x0118, &buffer, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-    battery_data->total_charge_ah = buffer;
-    vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
-
-    // Read 0x011A: Total discharge ampere hour of battery
-    if (readDataWithRetry32(0x011A, &buffer, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
-    battery_data->total_discharge_ah = buffer;
-    vTaskDelay(pdMS_TO_TICKS(COMMAND_INTERVAL_MS));
-    
-    // The value from 0x011C is already read by getChargeWh(), which is also called in slot_1
-    
-    return ESP_OK;
+    timing.consecutive_failures = 0;
 }
-// +++ END: เพิ่มฟังก์ชันใหม่ +++
-
-static esp_err_t readDataWithRetry(uint16_t start_address, uint16_t *value, uint8_t max_retry, uint16_t retry_interval_ms) {
-    uint8_t attempts = 0;
-    uint8_t responseBuffer[2] = {0};
-    while (attempts < max_retry) {
-        if (srneParseData(0x01, start_address, responseBuffer) == ESP_OK) {
-            *value = ((uint16_t)responseBuffer[0] << 8) | responseBuffer[1];
-            return ESP_OK;
+static void srneBusTask(void *parameter) {
+    SrneRequest request;
+
+    for (;;) {
+        // Drain every control request before looking at the telemetry queue
+        if (xQueueReceive(srne_control_queue, &request, 0) == pdTRUE ||
+            xQueueReceive(srne_telemetry_queue, &request, 0) == pdTRUE) {
+            esp_err_t result = executeRequest(request);
+            if (request.callback != NULL) request.callback(result, request.context);
+            if (request.notify_task != NULL) xTaskNotify(request.notify_task, (uint32_t)result, eSetValueWithOverwrite);
+            continue;
         }
-        attempts++;
-        vTaskDelay(pdMS_TO_TICKS(retry_interval_ms));
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     }
-    return ESP_FAIL;
-}
-static esp_err_t readDataWithRetry32(uint16_t start_address, uint32_t *value, uint8_t max_retry, uint16_t retry_interval_ms) {
-    uint8_t attempts = 0;
-    uint8_t rawBuffer[4] = {0};
-    while (attempts < max_retry) {
-        if (srneParseData32(0x01, start_address, (uint32_t*)rawBuffer) == ESP_OK) {
-            *value = (uint32_t)rawBuffer[0] << 24 | (uint32_t)rawBuffer[1] << 16 | (uint32_t)rawBuffer[2] << 8 | (uint32_t)rawBuffer[3];
-            return ESP_OK;
+}
+static uint32_t registerPairToU32(const uint16_t *registers) {
+    // SRNE 32-bit values are high word first
+    return (uint32_t)registers[0] << 16 | registers[1];
+}
+// Walks SRNE_TELEMETRY_MAP once and stores every register that lies inside the buffer into its
+// target pack. Packs passed as NULL are skipped.
+static void decodeTelemetry(uint16_t start_address, uint16_t count, const uint16_t *registers, batteryDataPack *battery_data, solarDataPack *solar_data, loadDataPack *load_data) {
+    uint8_t *packs[3] = {(uint8_t *)battery_data, (uint8_t *)solar_data, (uint8_t *)load_data};
+
+    for (size_t i = 0; i < SRNE_TELEMETRY_MAP_SIZE; i++) {
+        const SrneRegisterDesc &d = SRNE_TELEMETRY_MAP[i];
+        if (d.address < start_address || d.address + d.width > start_address + count) continue;
+
+        uint8_t *pack = packs[(uint8_t)d.pack];
+        if (pack == NULL) continue;
+
+        const uint16_t *raw = &registers[d.address - start_address];
+        int64_t value;
+        if (d.width == 2) value = registerPairToU32(raw);
+        else if (d.sign == SrneSign::SIGNED_LOW_BYTE) value = (int8_t)(raw[0] & 0xFF);
+        else value = raw[0];
+
+        void *field = pack + d.offset;
+        switch (d.field) {
+            case SrneField::FLOAT:  *(float *)field = value * d.scale; break;
+            case SrneField::INT:    *(int *)field = (int)(value * d.scale); break;
+            case SrneField::UINT32: *(uint32_t *)field = (uint32_t)value; break;
         }
-        attempts++;
-        vTaskDelay(pdMS_TO_TICKS(retry_interval_ms));
     }
-    return ESP_FAIL;
 }
-static esp_err_t srneParseData(uint8_t deviceAddress, uint16_t startAddress, uint8_t *pBuffer) {
-    const int32_t time_out_ms = 60;
+static esp_err_t readTelemetry(uint16_t start_address, uint16_t count, batteryDataPack *battery_data, solarDataPack *solar_data, loadDataPack *load_data) {
+    uint16_t registers[MAX_BLOCK_REGISTERS];
+    if (count > MAX_BLOCK_REGISTERS) return ESP_ERR_INVALID_ARG;
+    if (readBlockWithRetry(start_address, count, registers, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
+    decodeTelemetry(start_address, count, registers, battery_data, solar_data, load_data);
+    return ESP_OK;
+}
+static esp_err_t srneReadRegisters(uint8_t deviceAddress, uint16_t startAddress, uint16_t count, uint16_t *pRegisters, uint32_t time_out_ms) {
+    if (count == 0 || count > MAX_BLOCK_REGISTERS) return ESP_ERR_INVALID_ARG;
+
+    const size_t response_len = 5 + count * 2;
     uint8_t data[8];
-    uint8_t response[7]; 
-    memset(data, 0, sizeof(data));
+    uint8_t response[5 + MAX_BLOCK_REGISTERS * 2];
     data[0] = deviceAddress;
-    data[1] = 0x03; 
+    data[1] = 0x03;
     data[2] = (startAddress >> 8) & 0xFF;
     data[3] = startAddress & 0xFF;
-    data[4] = 0x00;
-    data[5] = 0x01; 
+    data[4] = (count >> 8) & 0xFF;
+    data[5] = count & 0xFF;
     uint16_t calculatedCrc;
-    calculateCRC16(data, 6, calculatedCrc);
+    calculatedCrc = crc16Modbus(data, 6);
     data[6] = calculatedCrc & 0xFF;
     data[7] = (calculatedCrc >> 8) & 0xFF;
-    while(srne_serial.available()) srne_serial.read();
-    srne_serial.write(data, sizeof(data));
-    srne_serial.flush();
-    srne_serial.setTimeout(time_out_ms);
-    size_t received_count = srne_serial.readBytes(response, sizeof(response));
-    if (received_count < sizeof(response)) return ESP_ERR_TIMEOUT;
-    if (response[0] != deviceAddress || response[1] != 0x03 || response[2] != 0x02) return ESP_FAIL;
-    uint16_t responseCrc = (response[6] << 8) | response[5];
-    calculateCRC16(response, 5, calculatedCrc);
-    if (responseCrc != calculatedCrc) return ESP_FAIL;
-    pBuffer[0] = response[3]; 
-    pBuffer[1] = response[4]; 
+    size_t received_count = 0;
+    esp_err_t err = srneTransceive(data, sizeof(data), response, response_len, time_out_ms, &received_count);
+    if (err != ESP_OK) return err;
+    if (received_count >= 5 && response[0] == deviceAddress && response[1] == (0x03 | 0x80)) return ESP_ERR_INVALID_RESPONSE;
+    if (received_count < response_len) return ESP_ERR_TIMEOUT;
+    if (response[0] != deviceAddress || response[1] != 0x03 || response[2] != count * 2) return ESP_FAIL;
+    uint16_t responseCrc = (response[response_len - 1] << 8) | response[response_len - 2];
+    calculatedCrc = crc16Modbus(response, response_len - 2);
+    if (responseCrc != calculatedCrc) return ESP_ERR_INVALID_CRC;
+    for (uint16_t i = 0; i < count; i++) {
+        pRegisters[i] = ((uint16_t)response[3 + i * 2] << 8) | response[4 + i * 2];
+    }
     return ESP_OK;
 }
-static esp_err_t srneParseData32(uint8_t deviceAddress, uint16_t startAddress, uint32_t *pBuffer) {
-    const int32_t time_out_ms = 60;
-    uint8_t data[8];
-    uint8_t response[9];
+// Takes [start_address, start_address + count) from the shadow (or reads it once), compares the registers selected by managed_mask
+// against desired and pushes the smallest contiguous range covering every difference in one FC 0x10
+// transaction. Unmanaged registers inside that range are written back with the value just read.
+static esp_err_t syncRegisterBlock(uint16_t start_address, uint16_t count, const uint16_t *desired, uint32_t managed_mask, uint8_t step_num) {
+    if (count == 0 || count > MAX_BLOCK_REGISTERS) return ESP_ERR_INVALID_ARG;
+
+    uint16_t current[MAX_BLOCK_REGISTERS];
+    if (!shadowGet(start_address, count, current) &&
+        readBlockWithRetry(start_address, count, current, MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) {
+        // Without a snapshot only the managed runs can be written safely
+        if (step_num != 0) Serial.printf("    -> Failed to read 0x%04X-0x%04X. Writing managed registers.\n", start_address, start_address + count - 1);
+        uint16_t i = 0;
+        while (i < count) {
+            if (!(managed_mask & (1UL << i))) { i++; continue; }
+            uint16_t run = 0;
+            while (i + run < count && (managed_mask & (1UL << (i + run)))) run++;
+            if (writeBlockWithRetry(start_address + i, run, &desired[i], MAX_RETRY, RETRY_INTERVAL_MS) != ESP_OK) return ESP_FAIL;
+            i += run;
+        }
+        return ESP_OK;
+    }
+
+    int16_t first = -1;
+    int16_t last = -1;
+    for (uint16_t i = 0; i < count; i++) {
+        if (!(managed_mask & (1UL << i))) continue;
+        if (step_num != 0) Serial.printf("    [CHECK] 0x%04X: Current value = %d, New value = %d\n", start_address + i, current[i], desired[i]);
+        if (current[i] != desired[i]) {
+            if (first < 0) first = i;
+            last = i;
+        }
+    }
+
+    if (first < 0) {
+        if (step_num != 0) Serial.printf("  %d.1 All values already set. Skipping write.\n", step_num);
+        return ESP_OK;
+    }
+
+    uint16_t merged[MAX_BLOCK_REGISTERS];
+    for (int16_t i = first; i <= last; i++) {
+        merged[i] = (managed_mask & (1UL << i)) ? desired[i] : current[i];
+    }
+    if (step_num != 0) Serial.printf("  %d.1 Writing %d registers at 0x%04X\n", step_num, last - first + 1, start_address + first);
+    return writeBlockWithRetry(start_address + first, last - first + 1, &merged[first], MAX_RETRY, RETRY_INTERVAL_MS);
+}
+static esp_err_t srneWriteRegisters(uint8_t deviceAddress, uint16_t startAddress, uint16_t count, const uint16_t *pValues, uint32_t time_out_ms) {
+    if (count == 0 || count > MAX_BLOCK_REGISTERS) return ESP_ERR_INVALID_ARG;
+
+    const size_t frame_len = 9 + count * 2;
+    uint8_t data[9 + MAX_BLOCK_REGISTERS * 2];
+    uint8_t response[8];
     data[0] = deviceAddress;
-    data[1] = 0x03;
+    data[1] = 0x10;
     data[2] = (startAddress >> 8) & 0xFF;
     data[3] = startAddress & 0xFF;
-    data[4] = 0x00;
-    data[5] = 0x02; 
+    data[4] = (count >> 8) & 0xFF;
+    data[5] = count & 0xFF;
+    data[6] = count * 2;
+    for (uint16_t i = 0; i < count; i++) {
+        data[7 + i * 2] = (pValues[i] >> 8) & 0xFF;
+        data[8 + i * 2] = pValues[i] & 0xFF;
+    }
     uint16_t calculatedCrc;
-    calculateCRC16(data, 6, calculatedCrc);
-    data[6] = calculatedCrc & 0xFF;
-    data[7] = (calculatedCrc >> 8) & 0xFF;
-    while(srne_serial.available()) srne_serial.read();
-    srne_serial.write(data, sizeof(data));
-    srne_serial.flush();
-    srne_serial.setTimeout(time_out_ms);
-    size_t received_count = srne_serial.readBytes(response, sizeof(response));
+    calculatedCrc = crc16Modbus(data, frame_len - 2);
+    data[frame_len - 2] = calculatedCrc & 0xFF;
+    data[frame_len - 1] = (calculatedCrc >> 8) & 0xFF;
+    size_t received_count = 0;
+    esp_err_t err = srneTransceive(data, frame_len, response, sizeof(response), time_out_ms, &received_count);
+    if (err != ESP_OK) return err;
+    // An exception reply (function code | 0x80) is only 5 bytes long
+    if (received_count >= 5 && response[0] == deviceAddress && response[1] == (0x10 | 0x80)) return ESP_ERR_INVALID_RESPONSE;
     if (received_count < sizeof(response)) return ESP_ERR_TIMEOUT;
-    if (response[0] != deviceAddress || response[1] != 0x03) return ESP_FAIL;
-    uint16_t responseCrc = (response[8] << 8) | response[7];
-    calculateCRC16(response, 7, calculatedCrc);
-    if (responseCrc != calculatedCrc) return ESP_FAIL;
-    uint8_t* byte_ptr = (uint8_t*)pBuffer;
-    byte_ptr[0] = response[3]; 
-    byte_ptr[1] = response[4];
-    byte_ptr[2] = response[5];
-    byte_ptr[3] = response[6]; 
+    // The reply echoes address, function code, start address and register count
+    for (int i = 0; i < 6; i++) {
+        if (data[i] != response[i]) return ESP_FAIL;
+    }
+    uint16_t responseCrc = (response[7] << 8) | response[6];
+    calculatedCrc = crc16Modbus(response, 6);
+    if (responseCrc != calculatedCrc) return ESP_ERR_INVALID_CRC;
     return ESP_OK;
 }
-static esp_err_t srneWriteData(uint8_t deviceAddress, uint16_t startAddress, uint16_t value) {
-    const uint32_t time_out_ms = 60;
+static esp_err_t srneWriteData(uint8_t deviceAddress, uint16_t startAddress, uint16_t value, uint32_t time_out_ms) {
     uint8_t data[8];
     uint8_t response[8];
     data[0] = deviceAddress;
@@ -662,37 +727,63 @@ static esp_err_t srneWriteData(uint8_t deviceAddress, uint16_t startAddress, uin
     data[4] = (value >> 8) & 0xFF;
     data[5] = value & 0xFF;
     uint16_t calculatedCrc;
-    calculateCRC16(data, 6, calculatedCrc);
+    calculatedCrc = crc16Modbus(data, 6);
     data[6] = calculatedCrc & 0xFF;
     data[7] = (calculatedCrc >> 8) & 0xFF;
-    while(srne_serial.available()) srne_serial.read();
-    srne_serial.write(data, sizeof(data));
-    srne_serial.flush();
-    srne_serial.setTimeout(time_out_ms);
-    size_t received_count = srne_serial.readBytes(response, sizeof(response));
+    size_t received_count = 0;
+    esp_err_t err = srneTransceive(data, sizeof(data), response, sizeof(response), time_out_ms, &received_count);
+    if (err != ESP_OK) return err;
+    if (received_count >= 5 && response[0] == deviceAddress && response[1] == (0x06 | 0x80)) return ESP_ERR_INVALID_RESPONSE;
     if (received_count < sizeof(response)) return ESP_ERR_TIMEOUT;
-    for (int i = 0; i < 8; i++) {
+    // The reply is a full echo; a mismatch in the CRC bytes alone means a corrupted frame
+    for (int i = 0; i < 6; i++) {
         if (data[i] != response[i]) return ESP_FAIL;
     }
+    if (data[6] != response[6] || data[7] != response[7]) return ESP_ERR_INVALID_CRC;
     return ESP_OK;
 }
-static esp_err_t calculateCRC16(const uint8_t *data, size_t length, uint16_t &crc)
-{
-    crc = 0xFFFF;
-    for (size_t i = 0; i < length; ++i)
-    {
-        crc ^= data[i];
-        for (size_t j = 0; j < 8; ++j)
-        {
-            if (crc & 0x0001)
-            {
-                crc = (crc >> 1) ^ 0xA001;
-            }
-            else
-            {
-                crc >>= 1;
-            }
+// Sends one request and collects the reply from the UART event queue. The transaction ends as soon
+// as response_size bytes have arrived or the driver reports an RX timeout (line silent for
+// SRNE_UART_RX_TIMEOUT_SYMBOLS characters) after data, so short exception frames do not wait out
+// time_out_ms either.
+static esp_err_t srneTransceive(const uint8_t *request, size_t request_len, uint8_t *response, size_t response_size, uint32_t time_out_ms, size_t *received_count) {
+    uart_event_t event;
+    size_t received = 0;
+
+    last_response_latency_us = 0;
+    if (srne_uart_events == NULL) return ESP_ERR_INVALID_STATE; // setupSrne() has not run
+
+    uart_flush_input(SRNE_UART_PORT);
+    xQueueReset(srne_uart_events);
+    uart_write_bytes(SRNE_UART_PORT, request, request_len);
+    uart_wait_tx_done(SRNE_UART_PORT, pdMS_TO_TICKS(100));
+
+    const int64_t sent_us = esp_timer_get_time();
+    const TickType_t start = xTaskGetTickCount();
+    const TickType_t budget = pdMS_TO_TICKS(time_out_ms);
+    esp_err_t result = ESP_OK;
+    while (received < response_size) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= budget) break;
+        if (xQueueReceive(srne_uart_events, &event, budget - elapsed) != pdTRUE) break;
+
+        if (event.type == UART_DATA) {
+            int n = uart_read_bytes(SRNE_UART_PORT, response + received, response_size - received, 0);
+            if (n > 0) received += n;
+            if (event.timeout_flag && received > 0) break; // Inter-frame silence: the reply is complete
+        } else if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL) {
+            uart_flush_input(SRNE_UART_PORT);
+            xQueueReset(srne_uart_events);
+            result = ESP_ERR_INVALID_STATE;
+            break;
+        } else if (event.type == UART_FRAME_ERR || event.type == UART_PARITY_ERR) {
+            result = ESP_ERR_INVALID_STATE;
+            break;
         }
     }
-    return ESP_OK;
-}
\ No newline at end of file
+
+    // Kept even for a short or corrupt reply, for diagnostics; only a clean reply feeds the RTT estimate
+    last_response_latency_us = (uint32_t)(esp_timer_get_time() - sent_us);
+    *received_count = received;
+    return result;
+}
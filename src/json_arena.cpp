@@ -0,0 +1,164 @@
+// FILE: json_arena.cpp
+
+#include "json_arena.h"
+#include <atomic>
+
+// Each block is preceded by its size, so reallocate() knows how much to copy. Blocks are aligned
+// like malloc's.
+const size_t BLOCK_ALIGN = 8;
+const size_t BLOCK_HEADER = BLOCK_ALIGN;
+
+// --- Module-level (static) variables ---
+static uint8_t arena_storage[JSON_ARENA_COUNT][JSON_ARENA_SIZE] __attribute__((aligned(BLOCK_ALIGN)));
+static JsonArena arenas[JSON_ARENA_COUNT] = {
+    JsonArena(arena_storage[0], JSON_ARENA_SIZE),
+    JsonArena(arena_storage[1], JSON_ARENA_SIZE),
+};
+static_assert(JSON_ARENA_COUNT == 2, "Update the arenas initialiser");
+
+static portMUX_TYPE pool_mux = portMUX_INITIALIZER_UNLOCKED;
+static std::atomic<uint32_t> high_water(0);
+static std::atomic<uint32_t> heap_fallbacks(0);
+
+// Stands in for an arena when the pool is exhausted
+class HeapAllocator : public ArduinoJson::Allocator
+{
+public:
+    void *allocate(size_t size) override
+    {
+        heap_fallbacks.fetch_add(1, std::memory_order_relaxed);
+        return malloc(size);
+    }
+    void deallocate(void *ptr) override { free(ptr); }
+    void *reallocate(void *ptr, size_t new_size) override
+    {
+        heap_fallbacks.fetch_add(1, std::memory_order_relaxed);
+        return realloc(ptr, new_size);
+    }
+};
+static HeapAllocator heap_allocator;
+
+// --- Public Function Implementations ---
+
+JsonArena::JsonArena(uint8_t *storage, size_t capacity)
+    : leased(false), storage(storage), capacity(capacity), used(0), last_block(NULL)
+{
+}
+
+void *JsonArena::allocate(size_t size)
+{
+    size_t block = BLOCK_HEADER + ((size + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1));
+    if (block > capacity - used)
+    {
+        heap_fallbacks.fetch_add(1, std::memory_order_relaxed);
+        return malloc(size);
+    }
+
+    uint8_t *header = storage + used;
+    *(size_t *)header = size;
+    used += block;
+    last_block = header + BLOCK_HEADER;
+
+    uint32_t peak = high_water.load(std::memory_order_relaxed);
+    while (used > peak && !high_water.compare_exchange_weak(peak, used, std::memory_order_relaxed))
+    {
+    }
+    return last_block;
+}
+
+void JsonArena::deallocate(void *ptr)
+{
+    if (ptr == NULL) return;
+    if (!owns(ptr))
+    {
+        free(ptr);
+        return;
+    }
+
+    // Everything else goes when the lease ends
+    if (ptr == last_block)
+    {
+        used = (uint8_t *)ptr - BLOCK_HEADER - storage;
+        last_block = NULL;
+    }
+}
+
+void *JsonArena::reallocate(void *ptr, size_t new_size)
+{
+    if (ptr == NULL) return allocate(new_size);
+    if (!owns(ptr))
+    {
+        heap_fallbacks.fetch_add(1, std::memory_order_relaxed);
+        return realloc(ptr, new_size);
+    }
+
+    // Grow or shrink the newest block in place
+    size_t offset = (uint8_t *)ptr - storage;
+    size_t block = BLOCK_HEADER + ((new_size + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1));
+    if (ptr == last_block && block <= capacity - (offset - BLOCK_HEADER))
+    {
+        *(size_t *)((uint8_t *)ptr - BLOCK_HEADER) = new_size;
+        used = offset - BLOCK_HEADER + block;
+        return ptr;
+    }
+
+    size_t old_size = blockSize(ptr);
+    if (new_size <= old_size) return ptr;
+
+    void *moved = allocate(new_size);
+    if (moved != NULL) memcpy(moved, ptr, old_size);
+    return moved;
+}
+
+void JsonArena::reset()
+{
+    used = 0;
+    last_block = NULL;
+}
+
+bool JsonArena::owns(const void *ptr) const
+{
+    return (const uint8_t *)ptr >= storage && (const uint8_t *)ptr < storage + capacity;
+}
+
+size_t JsonArena::blockSize(const void *ptr) const
+{
+    return *(const size_t *)((const uint8_t *)ptr - BLOCK_HEADER);
+}
+
+JsonArenaLease::JsonArenaLease() : arena(NULL)
+{
+    portENTER_CRITICAL(&pool_mux);
+    for (uint8_t i = 0; i < JSON_ARENA_COUNT; i++)
+    {
+        if (!arenas[i].leased)
+        {
+            arenas[i].leased = true;
+            arena = &arenas[i];
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&pool_mux);
+}
+
+JsonArenaLease::~JsonArenaLease()
+{
+    if (arena == NULL) return;
+
+    arena->reset(); // The document declared after the lease is already gone
+    portENTER_CRITICAL(&pool_mux);
+    arena->leased = false;
+    portEXIT_CRITICAL(&pool_mux);
+}
+
+ArduinoJson::Allocator *JsonArenaLease::allocator()
+{
+    if (arena != NULL) return arena;
+    return &heap_allocator;
+}
+
+void jsonArenaGetStats(JsonArenaStats *stats)
+{
+    stats->high_water_bytes = high_water.load(std::memory_order_relaxed);
+    stats->heap_fallbacks = heap_fallbacks.load(std::memory_order_relaxed);
+}
@@ -7,23 +7,36 @@
 #include "hal_rtc.h"
 #include "hal_srne.h"
 #include "timerRoutine.h"
+#include "scheduler.h"
+#include "telemetry_pipeline.h"
+#include "runtime_profile.h"
+#include "boot_trace.h"
 #include "connectivity_ota.h"
+#include "threshold_monitor.h"
 
 // --- Function Prototypes ---
 esp_err_t configSrne();
+void srneConfigTask(void *parameter);
+void registerJobs();
+void loadDeadbands();
+void loadThresholds();
+uint16_t loadThresholdLevel(const char *prefix, uint8_t signal, uint16_t default_level);
 void demoLoadRampDown();
 // --- Global Task Handles ---
 TaskHandle_t resetTaskHandle = NULL;
 TaskHandle_t wifiMqttTaskHandle = NULL;
 TaskHandle_t elegantTaskHandle = NULL;
+TaskHandle_t srneConfigTaskHandle = NULL;
 
 void setup()
 {
     setupMCU();
+    bootTraceMark("mcu_setup");
 
     String mac_address = WiFi.macAddress();
     mac_address.replace(":", "");
-    String client_id_str = "ESP32-SRNE-" + mac_address;
+    static String client_id_str; // Outlives setup(): WiFiMqttTask connects with it
+    client_id_str = "ESP32-SRNE-" + mac_address;
     myMQTT.client_name = client_id_str.c_str();
     Serial.printf("✅ MQTT Client ID set to: %s\n", myMQTT.client_name);
 
@@ -34,6 +47,7 @@ void setup()
         err = nvs_flash_init();
     }
     ESP_ERROR_CHECK(err);
+    bootTraceMark("nvs_init");
 
     initNVS("b2eco");
     loaded_tud = loadIntFromNVS("tud", "tud_bu", 0);
@@ -42,25 +56,45 @@ void setup()
 
     Wire.begin(); 
     bool rtc_available = (setupDs3231() == ESP_OK);
+    bootTraceMark("rtc_probe");
 
     setupExternalInterrupt(EXTERNAL_INTERRUPT_PIN, SERIAL_TX_PIN, SERIAL_RX_PIN);
     xTaskCreatePinnedToCore(resetListenerTask, "ResetListener", 4096, NULL, 5, &resetTaskHandle, 1);
 
+    // Connectivity comes up on core 0 while the controller is configured on core 1
+    setupWiFi(myWiFi);
+    setupMQTT(myMQTT);
+    xTaskCreatePinnedToCore(keepWiFiMqttAlive, "WiFiMqttTask", 8192, NULL, 4, &wifiMqttTaskHandle, 0);
+    xTaskCreatePinnedToCore(elegantTask, "ElegantOTATask", 4096, NULL, 3, &elegantTaskHandle, 0);
+
+    uint32_t publish_period_ms = loadIntFromNVS("pub", "pub_bu", PUBLISH_PERIOD_DEFAULT_S) * 1000UL;
+    if (publish_period_ms == 0) publish_period_ms = PUBLISH_PERIOD_DEFAULT_S * 1000UL;
+    uint8_t wire_format = loadIntFromNVS("wfm", "wfm_bu", (uint8_t)WireFormat::JSON);
+    setWireFormat(wire_format < WIRE_FORMAT_COUNT ? (WireFormat)wire_format : WireFormat::JSON);
+    BatchPolicy batch_policy;
+    batch_policy.max_samples = loadIntFromNVS("bsz", "bsz_bu", BATCH_SAMPLES_DEFAULT);
+    batch_policy.max_age_s = loadIntFromNVS("bag", "bag_bu", BATCH_MAX_AGE_DEFAULT_S);
+    batch_policy.flush_on_alarm = loadIntFromNVS("bal", "bal_bu", 1) == 1;
+    if (batch_policy.max_age_s == 0) batch_policy.max_age_s = BATCH_MAX_AGE_DEFAULT_S;
+    setBatchPolicy(batch_policy);
+    setReportByException(loadIntFromNVS("rbe", "rbe_bu", 0));
+    loadDeadbands();
+    loadThresholds();
+    startTelemetryPipeline(publish_period_ms, "test/data/up1");
+
     if (rtc_available && loaded_tud) {
         if (setupSrne(SRNE_RX_PIN, SRNE_TX_PIN) == ESP_OK) {
-             getCurrentTime(&time_data);
-             setChargingProfile(time_data, &charge_profile);
-
-            Serial.println("Forcing SRNE configuration on every boot...");
-            if (configSrne() == ESP_OK) {
-                saveIntToNVS("pgr", "pgr_bu", 1);
-                loaded_pgr = loadIntFromNVS("pgr", "pgr_bu", 1);
-                Serial.println("✅ SRNE controller configured successfully.");
-            } else {
-                Serial.println("❌ SRNE configuration failed. Halting.");
+            bootTraceMark("srne_setup");
+            timeDataPack boot_time = {};
+            getCurrentTime(&boot_time);
+            setChargingProfile(boot_time, &charge_profile);
+
+            // Acquisition starts below while the configuration is written; the bus task
+            // interleaves both
+            if (xTaskCreatePinnedToCore(srneConfigTask, "SrneConfigTask", 4096, NULL, 2, &srneConfigTaskHandle, 1) != pdPASS) {
+                Serial.println("❌ Failed to start SRNE configuration task. Halting.");
                 while(true) vTaskDelay(1000);
             }
-
         } else {
             Serial.println("❌ SRNE communication failed. Halting.");
             while(true) vTaskDelay(1000);
@@ -69,34 +103,16 @@ void setup()
         Serial.println("⚠️ RTC not found or time not set. Waiting for command...");
     }
 
-    clearAccumulateData();
-
-    setupWiFi(myWiFi);
-    setupMQTT(myMQTT);
-
-    xTaskCreatePinnedToCore(keepWiFiMqttAlive, "WiFiMqttTask", 8192, NULL, 4, &wifiMqttTaskHandle, 0);
-    xTaskCreatePinnedToCore(elegantTask, "ElegantOTATask", 4096, NULL, 3, &elegantTaskHandle, 0);
-
-    setupTimer(5.0);
+    registerJobs();
+    schedulerStart(xTaskGetCurrentTaskHandle()); // setup() and loop() share the loop task
+    bootTraceMark("setup_done");
 }
 
 void loop()
 {
-    if (!taskDone)
-    {
-        esp_task_wdt_reset();
-        switch (s) {
-            case 1:  slot_1_update_data();              break;
-            case 2:  slot_2_safety_checks();            break;
-            case 3:  slot_3_forecasting_and_adjustment(); break;
-            case 4:  slot_4_integration_check();        break;
-            case 5:  slot_5_publish_data();             break;
-            // +++ START: เพิ่ม case 6 +++
-            // case 6:  slot_6_Load_Control();             break;
-            // +++ END: เพิ่ม case 6 +++
-        }
-        taskDone = true;
-    }
+    // Sleeps until the timer releases a job; wakes once a second anyway to feed the watchdog
+    schedulerDispatch(1000);
+    esp_task_wdt_reset();
     // if (TimeStartNewCurrent = 5 && !NewCurrent)
     // {
     //     demoLoadRampDown();
@@ -122,63 +138,100 @@ void loop()
     // if (load_data.load_current < 0.1 && TimeStartNewCurrent > 0) {
     //     TimeStartNewCurrent = 0;
     // }
+}
 
-    vTaskDelay(pdMS_TO_TICKS(10));
+// Rate-monotonic priorities: the shorter the period, the higher the priority (0 = highest).
+// Every deadline equals its period. Publishing runs on core 0 from the telemetry pipeline.
+void registerJobs()
+{
+    schedulerAddJob("safety",    slot_2_safety_checks,              1000,  1000,  0);
+    schedulerAddJob("acquire",   slot_1_update_data,                2000,  2000,  1);
+    schedulerAddJob("integrate", slot_4_integration_check,          30000, 30000, 2);
+    schedulerAddJob("forecast",  slot_3_forecasting_and_adjustment, 60000, 60000, 3);
+    schedulerAddJob("profile",   runtimeProfileSample,              60000, 60000, 5);
+    // schedulerAddJob("load",   slot_6_Load_Control,               30000, 30000, 4);
 }
 
-esp_err_t configSrne()
+// Deadbands set over the command port; "dbs" is only written once one has been
+void loadDeadbands()
 {
-    
-    Serial.println("--- Starting SRNE Configuration ---");
-    uint8_t step = 1;
+    if (loadIntFromNVS("dbs", "dbs_bu", 0) != 1) return;
 
-    Serial.printf("%d. Set Max Charge Current\n", step);
-    if (setMaxChargeCurrent(charge_profile.max_charge_current, step++) != ESP_OK) {
-        Serial.println("   -> FAILED"); return ESP_FAIL;
+    uint8_t count;
+    const DeadbandField *fields = deadbandFields(&count);
+    for (uint8_t i = 0; i < count; i++) {
+        char abs_key[8], abs_backup[12], rel_key[8], rel_backup[12];
+        snprintf(abs_key, sizeof(abs_key), "da%u", i);
+        snprintf(abs_backup, sizeof(abs_backup), "da%u_bu", i);
+        snprintf(rel_key, sizeof(rel_key), "dr%u", i);
+        snprintf(rel_backup, sizeof(rel_backup), "dr%u_bu", i);
+        setDeadband(i, loadIntFromNVS(abs_key, abs_backup, fields[i].absolute), loadIntFromNVS(rel_key, rel_backup, fields[i].relative_pct));
     }
-    vTaskDelay(pdMS_TO_TICKS(1000)); // Add delay between major steps
+}
 
-    Serial.printf("%d. Set Max Load Current\n", step);
-    if (setMaxLoadCurrent(device_setting.max_load_current, step++) != ESP_OK) {
-        Serial.println("   -> FAILED"); return ESP_FAIL;
-    }
-    vTaskDelay(pdMS_TO_TICKS(1000)); // Add delay between major steps
+// Protection levels set over the command port, in hundredths; "ths" is only written once one has been
+void loadThresholds()
+{
+    if (loadIntFromNVS("ths", "ths_bu", 0) != 1) return;
 
-    Serial.printf("%d. Set Load Percentage\n", step);
-    if (setLoadPercentage(device_setting.load_percentage, step++) != ESP_OK) {
-        Serial.println("   -> FAILED"); return ESP_FAIL;
-    }
-    vTaskDelay(pdMS_TO_TICKS(1000)); // Add delay between major steps
-    
-    Serial.printf("%d. Set Light Control Voltage\n", step);
-    if (setLightControlVoltage(device_setting.voltage_light_control, step++) != ESP_OK) {
-        Serial.println("   -> FAILED"); return ESP_FAIL;
-    }
-    vTaskDelay(pdMS_TO_TICKS(1000)); // Add delay between major steps
-    
-    Serial.printf("%d. Set Manual Mode\n", step);
-    if (setManualMode(step++) != ESP_OK) {
-        Serial.println("   -> FAILED"); return ESP_FAIL;
+    uint8_t count;
+    const ThresholdRule *rules = thresholdRules(&count);
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t signal = (uint8_t)rules[i].signal;
+        uint16_t trip = loadThresholdLevel("tt", signal, lroundf(rules[i].trip_level * 100));
+        uint16_t release = loadThresholdLevel("tr", signal, lroundf(rules[i].release_level * 100));
+        if (thresholdSetLimits(rules[i].signal, trip / 100.0f, release / 100.0f) != ESP_OK) {
+            Serial.printf("⚠️ Stored limits for %s are invalid, keeping the defaults.\n", rules[i].name);
+        }
     }
-    vTaskDelay(pdMS_TO_TICKS(1000)); // Add delay between major steps
+}
+
+uint16_t loadThresholdLevel(const char *prefix, uint8_t signal, uint16_t default_level)
+{
+    char high_key[8], high_backup[12], low_key[8], low_backup[12];
+    snprintf(high_key, sizeof(high_key), "%sh%u", prefix, signal);
+    snprintf(high_backup, sizeof(high_backup), "%sh%u_bu", prefix, signal);
+    snprintf(low_key, sizeof(low_key), "%sl%u", prefix, signal);
+    snprintf(low_backup, sizeof(low_backup), "%sl%u_bu", prefix, signal);
+    return (loadIntFromNVS(high_key, high_backup, default_level >> 8) << 8) | loadIntFromNVS(low_key, low_backup, default_level & 0xFF);
+}
 
-    Serial.printf("%d. Set Load Schedules\n", step);
+esp_err_t configSrne()
+{
+    Serial.println("--- Starting SRNE Configuration ---");
     esp_task_wdt_reset();
-    if (setLoadSchedules(load_schedule, SCHEDULE_SLOT_COUNT, step++) != ESP_OK) {
-        Serial.println("   -> FAILED"); return ESP_FAIL;
-    }
-    vTaskDelay(pdMS_TO_TICKS(500)); // Add delay between major steps
 
-    Serial.printf("%d. Set Lithium Battery Parameters\n", step);
-    if (setLithiumBattery(device_setting, step++) != ESP_OK) {
+    if (reconcileSrneConfig(charge_profile, device_setting, load_schedule, SCHEDULE_SLOT_COUNT) != ESP_OK) {
         Serial.println("   -> FAILED"); return ESP_FAIL;
     }
-    vTaskDelay(pdMS_TO_TICKS(500)); // Add delay between major steps
-    
+
     Serial.println("--- SRNE Configuration Finished ---");
 
     return ESP_OK;
 }
+// One-shot boot task, started once setupSrne() has the bus up. Acquisition jobs may already have
+// written a protective charge current cap, which the profile write in the configuration would
+// lift, so the caps are re-applied afterwards.
+void srneConfigTask(void *parameter)
+{
+    Serial.println("Forcing SRNE configuration on every boot...");
+    if (configSrne() == ESP_OK) {
+        saveIntToNVS("pgr", "pgr_bu", 1);
+        loaded_pgr = loadIntFromNVS("pgr", "pgr_bu", 1);
+        clearAccumulateData();
+        if (integrated) applyChargeCurrent();
+        bootTraceMark("srne_config");
+        Serial.printf("✅ SRNE controller configured successfully (%lu ms after power-on).\n", (unsigned long)millis());
+    } else {
+        Serial.println("❌ SRNE configuration failed. Restarting.");
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        esp_restart();
+    }
+
+    srneConfigTaskHandle = NULL;
+    vTaskDelete(NULL);
+}
+
 void demoLoadRampDown() {
     Serial.println("Step 1: Turning load ON at 100% power (in test mode).");
     
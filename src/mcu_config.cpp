@@ -1,26 +1,37 @@
 // FILE: mcu_config.cpp
 
 #include "mcu_config.h"
+#include "telemetry_store.h"
+#include "esp_timer.h"
 
 HardwareSerial serial_port(2);
-hw_timer_t *timer = NULL;
+static esp_timer_handle_t tick_timer = NULL;
+static TaskHandle_t slot_dispatcher = NULL;
+// TimeStartNewCurrent counts 5 s periods, as it did when the timer itself ran every 5 s
+static const float LOAD_TIME_PERIOD_S = 5.0f;
+static uint32_t ticks_per_load_period = 1;
+static uint32_t load_period_ticks = 0;
 
 void IRAM_ATTR interruptUploadMode()
 {
     upload_mode = true;
 }
 
-void IRAM_ATTR timer5s()
+// Runs on the esp_timer task, not in an ISR
+static void timerTick(void *arg)
 {
-    taskDone = false;
-    s++;
-    // +++ START: แก้ไขรอบของ Timer +++
-    if (s > 6) // เดิมคือ 12, แก้เป็น 6 เพื่อให้วนครบ 6 slots
-    {
-        s = 1;
-    }
-    // +++ END: แก้ไขรอบของ Timer +++
-    if (load_data.load_current > 0.1) // Use a small threshold to account for noise
+    (void)arg;
+
+    // Every tick adds one to the dispatcher's notification value, so ticks that land while a job
+    // is still running are queued rather than overwritten
+    xTaskNotify(slot_dispatcher, 0, eIncrement);
+
+    if (++load_period_ticks < ticks_per_load_period) return;
+    load_period_ticks = 0;
+
+    TelemetrySnapshot telemetry;
+    telemetryStoreRead(&telemetry);
+    if (telemetry.load.load_current > 0.1) // Use a small threshold to account for noise
     {
         TimeStartNewCurrent++;
     }
@@ -44,21 +55,26 @@ void setupMCU()
     vTaskDelay(pdMS_TO_TICKS(50));
 }
 
-esp_err_t setupTimer(float time_s)
+esp_err_t setupTimer(float time_s, TaskHandle_t dispatcher_task)
 {
-    uint64_t ticks = (uint64_t)(time_s * 1000000);
+    uint64_t period_us = (uint64_t)(time_s * 1000000);
+    slot_dispatcher = dispatcher_task;
+    ticks_per_load_period = (uint32_t)lroundf(LOAD_TIME_PERIOD_S / time_s);
+    if (ticks_per_load_period == 0) ticks_per_load_period = 1;
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = &timerTick;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "tick";
 
-    timer = timerBegin(0, 80, true); // Use prescaler 80 for 1MHz clock
-    if (!timer)
+    esp_err_t err = esp_timer_create(&timer_args, &tick_timer);
+    if (err == ESP_OK) err = esp_timer_start_periodic(tick_timer, period_us);
+    if (err != ESP_OK)
     {
-        Serial.println("❌ Failed to begin hardware timer");
-        return ESP_FAIL;
+        Serial.println("❌ Failed to start tick timer");
+        return err;
     }
 
-    timerAttachInterrupt(timer, &timer5s, true);
-    timerAlarmWrite(timer, ticks, true);
-    timerAlarmEnable(timer);
-
     return ESP_OK;
 }
 
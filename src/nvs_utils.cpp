@@ -1,21 +1,7 @@
 // FILE: nvs_utils.cpp
 
 #include "nvs_utils.h"
-
-// Private function for this file
-uint32_t crc32(const uint8_t *data, size_t length)
-{
-    uint32_t crc = 0xFFFFFFFF;
-    while (length--)
-    {
-        crc ^= *data++;
-        for (uint8_t i = 0; i < 8; i++)
-        {
-            crc = (crc >> 1) ^ (0xEDB88320 & (-(int)(crc & 1)));
-        }
-    }
-    return ~crc;
-}
+#include "crc_utils.h"
 
 void initNVS(const char *keyname)
 {
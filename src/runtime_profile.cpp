@@ -0,0 +1,153 @@
+// FILE: runtime_profile.cpp
+
+#include "runtime_profile.h"
+#include "esp_heap_caps.h"
+
+// --- Module-level (static) variables ---
+static RuntimeProfile latest = {};
+static portMUX_TYPE profile_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t sample_mutex = xSemaphoreCreateMutex(); // Scheduler job and on-demand requests
+
+#if configUSE_TRACE_FACILITY
+static TaskStatus_t task_status[PROFILE_MAX_TASKS];
+#endif
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+// Run-time counters from the previous sample, keyed by task number, for per-window CPU share
+static UBaseType_t previous_task_number[PROFILE_MAX_TASKS];
+static uint32_t previous_runtime[PROFILE_MAX_TASKS];
+static uint8_t previous_count = 0;
+static uint32_t previous_total_runtime = 0;
+#endif
+
+// --- Private Function Prototypes ---
+static uint8_t sampleTasks(TaskProfile *tasks);
+
+// --- Public Function Implementations ---
+
+void runtimeProfileSample()
+{
+    static RuntimeProfile sample; // Too large for the loop task's stack
+    if (xSemaphoreTake(sample_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) return;
+
+    sample.task_count = sampleTasks(sample.tasks);
+    sample.heap_free_bytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    sample.heap_largest_block_bytes = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    sample.heap_min_free_bytes = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+
+    uint32_t now_ms = millis();
+    sample.window_ms = latest.sampled_ms ? now_ms - latest.sampled_ms : now_ms;
+    sample.sampled_ms = now_ms;
+
+    portENTER_CRITICAL(&profile_mux);
+    latest = sample;
+    portEXIT_CRITICAL(&profile_mux);
+
+    xSemaphoreGive(sample_mutex);
+}
+
+void runtimeProfileGet(RuntimeProfile *profile)
+{
+    portENTER_CRITICAL(&profile_mux);
+    *profile = latest;
+    portEXIT_CRITICAL(&profile_mux);
+}
+
+void runtimeProfilePrint()
+{
+    static RuntimeProfile profile;
+    runtimeProfileGet(&profile);
+
+    if (profile.sampled_ms == 0)
+    {
+        Serial.println("⚠️ No runtime profile sampled yet.");
+        return;
+    }
+
+    Serial.printf("========== Runtime profile (%lu s window) =====================\n", (unsigned long)(profile.window_ms / 1000));
+    Serial.println("  Task             Core Prio   CPU %   Stack free (B)");
+    for (uint8_t i = 0; i < profile.task_count; i++)
+    {
+        const TaskProfile &task = profile.tasks[i];
+        char core[4];
+        if (task.core < 0) snprintf(core, sizeof(core), "-");
+        else snprintf(core, sizeof(core), "%d", task.core);
+
+        if (task.cpu_permille >= 0)
+        {
+            Serial.printf("  %-16s %4s %4u  %5.1f   %8lu\n", task.name, core, task.priority, task.cpu_permille / 10.0, (unsigned long)task.stack_free_bytes);
+        }
+        else
+        {
+            Serial.printf("  %-16s %4s %4u  %5s   %8lu\n", task.name, core, task.priority, "n/a", (unsigned long)task.stack_free_bytes);
+        }
+    }
+    Serial.printf("  Heap free %lu B, largest block %lu B, minimum ever %lu B\n",
+                  (unsigned long)profile.heap_free_bytes, (unsigned long)profile.heap_largest_block_bytes, (unsigned long)profile.heap_min_free_bytes);
+    Serial.println("--------------------------------------------------------------");
+}
+
+// --- Private Function Implementations ---
+
+static uint8_t sampleTasks(TaskProfile *tasks)
+{
+#if configUSE_TRACE_FACILITY
+    uint32_t total_runtime = 0;
+    UBaseType_t count = uxTaskGetSystemState(task_status, PROFILE_MAX_TASKS, &total_runtime);
+    if (count == 0)
+    {
+        Serial.printf("⚠️ More than %u tasks; runtime profile skipped.\n", PROFILE_MAX_TASKS);
+        return 0;
+    }
+
+#if configGENERATE_RUN_TIME_STATS
+    // The run-time clock is shared by both cores, so full load on both is 2x the elapsed counter
+    uint64_t window = (uint64_t)(total_runtime - previous_total_runtime) * portNUM_PROCESSORS;
+#endif
+
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+        const TaskStatus_t &status = task_status[i];
+        TaskProfile &task = tasks[i];
+
+        strncpy(task.name, status.pcTaskName, sizeof(task.name) - 1);
+        task.name[sizeof(task.name) - 1] = '\0';
+        task.priority = status.uxCurrentPriority;
+        task.stack_free_bytes = status.usStackHighWaterMark; // ESP-IDF stacks are counted in bytes
+#if configTASKLIST_INCLUDE_COREID
+        task.core = (status.xCoreID >= 0 && status.xCoreID < portNUM_PROCESSORS) ? status.xCoreID : -1;
+#else
+        task.core = -1;
+#endif
+
+        task.cpu_permille = -1;
+#if configGENERATE_RUN_TIME_STATS
+        // Tasks created since the last sample are measured from zero
+        uint32_t runtime_before = 0;
+        for (uint8_t j = 0; j < previous_count; j++)
+        {
+            if (previous_task_number[j] == status.xTaskNumber)
+            {
+                runtime_before = previous_runtime[j];
+                break;
+            }
+        }
+        if (window > 0) task.cpu_permille = (int16_t)((uint64_t)(status.ulRunTimeCounter - runtime_before) * 1000 / window);
+#endif
+    }
+
+#if configGENERATE_RUN_TIME_STATS
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+        previous_task_number[i] = task_status[i].xTaskNumber;
+        previous_runtime[i] = task_status[i].ulRunTimeCounter;
+    }
+    previous_count = count;
+    previous_total_runtime = total_runtime;
+#endif
+
+    return count;
+#else
+    (void)tasks;
+    return 0; // Needs CONFIG_FREERTOS_USE_TRACE_FACILITY; heap figures are still reported
+#endif
+}
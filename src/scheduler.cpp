@@ -0,0 +1,157 @@
+// FILE: scheduler.cpp
+
+#include "scheduler.h"
+#include "mcu_config.h"
+#include "boot_trace.h"
+
+// --- Module-level (static) variables ---
+static SchedulerJob jobs[SCHEDULER_MAX_JOBS];
+static uint8_t job_count = 0;
+static uint32_t current_tick = 0;
+static int64_t start_us = 0;
+static const int64_t TICK_US = (int64_t)SCHEDULER_TICK_MS * 1000;
+
+// --- Private Function Prototypes ---
+static uint32_t periodToTicks(uint32_t period_ms);
+static void advanceTicks(uint32_t ticks);
+static SchedulerJob *nextReadyJob();
+
+// --- Public Function Implementations ---
+
+esp_err_t schedulerAddJob(const char *name, SchedulerJobFunction run, uint32_t period_ms, uint32_t deadline_ms, uint8_t priority)
+{
+    if (job_count >= SCHEDULER_MAX_JOBS || run == NULL || period_ms == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    SchedulerJob &job = jobs[job_count];
+    job = SchedulerJob();
+    job.name = name;
+    job.run = run;
+    job.period_ticks = periodToTicks(period_ms);
+    job.priority = priority;
+    job.timing.name = name;
+    job.timing.deadline_us = deadline_ms * 1000;
+    job_count++;
+
+    Serial.printf("🗓️ Job %-9s every %lu ms, deadline %lu ms, priority %d\n",
+                  name, (unsigned long)(job.period_ticks * SCHEDULER_TICK_MS), (unsigned long)deadline_ms, priority);
+    return ESP_OK;
+}
+
+esp_err_t schedulerStart(TaskHandle_t dispatcher_task)
+{
+    start_us = esp_timer_get_time();
+    current_tick = 0;
+
+    // Every job is released at tick 0 and runs once in priority order on the first dispatch
+    for (uint8_t i = 0; i < job_count; i++)
+    {
+        jobs[i].pending = true;
+        jobs[i].release_us = start_us;
+        jobs[i].next_release_tick = jobs[i].period_ticks;
+    }
+
+    return setupTimer(SCHEDULER_TICK_MS / 1000.0f, dispatcher_task);
+}
+
+void schedulerDispatch(uint32_t wait_ms)
+{
+    advanceTicks(ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms)));
+
+    SchedulerJob *job;
+    while ((job = nextReadyJob()) != NULL)
+    {
+        job->pending = false;
+
+        static bool first_run_traced = false;
+        if (!first_run_traced)
+        {
+            first_run_traced = true;
+            bootTraceMark("first_job");
+        }
+
+        esp_task_wdt_reset();
+        int64_t begin_us = esp_timer_get_time();
+        job->run();
+        execTimingRecordRelease(job->timing, job->release_us, begin_us, esp_timer_get_time());
+
+        // Pick up ticks that arrived while the job ran so the next choice sees every release
+        advanceTicks(ulTaskNotifyTake(pdTRUE, 0));
+    }
+}
+
+const SchedulerJob *schedulerJobs(uint8_t *count)
+{
+    *count = job_count;
+    return jobs;
+}
+
+void schedulerPrint()
+{
+    const ExecTimingStats *timings[SCHEDULER_MAX_JOBS];
+    for (uint8_t i = 0; i < job_count; i++)
+    {
+        timings[i] = &jobs[i].timing;
+    }
+    execTimingPrint(timings, job_count);
+
+    for (uint8_t i = 0; i < job_count; i++)
+    {
+        Serial.printf("  %-10s period %6lu ms, priority %d, skipped releases %lu\n", jobs[i].name,
+                      (unsigned long)(jobs[i].period_ticks * SCHEDULER_TICK_MS), jobs[i].priority, (unsigned long)jobs[i].skipped);
+    }
+}
+
+// --- Private Function Implementations ---
+
+static uint32_t periodToTicks(uint32_t period_ms)
+{
+    uint32_t ticks = (period_ms + SCHEDULER_TICK_MS / 2) / SCHEDULER_TICK_MS;
+    return ticks ? ticks : 1;
+}
+
+// Releases every job due within the next `ticks` timer ticks. A job still waiting to start when it
+// is released again keeps its older release and counts the newer one as skipped, so a late job
+// runs once instead of bursting to catch up.
+static void advanceTicks(uint32_t ticks)
+{
+    while (ticks--)
+    {
+        current_tick++;
+        for (uint8_t i = 0; i < job_count; i++)
+        {
+            SchedulerJob &job = jobs[i];
+            if ((int32_t)(current_tick - job.next_release_tick) < 0) continue;
+
+            if (job.pending)
+            {
+                job.skipped++;
+            }
+            else
+            {
+                job.pending = true;
+                job.release_us = start_us + (int64_t)current_tick * TICK_US;
+            }
+            job.next_release_tick = current_tick + job.period_ticks;
+        }
+    }
+}
+
+// Highest priority released job; ties go to the earliest release
+static SchedulerJob *nextReadyJob()
+{
+    SchedulerJob *best = NULL;
+    for (uint8_t i = 0; i < job_count; i++)
+    {
+        SchedulerJob &job = jobs[i];
+        if (!job.pending) continue;
+        if (best == NULL || job.priority < best->priority ||
+            (job.priority == best->priority && job.release_us < best->release_us))
+        {
+            best = &job;
+        }
+    }
+    return best;
+}
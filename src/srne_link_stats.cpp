@@ -0,0 +1,138 @@
+// FILE: srne_link_stats.cpp
+
+#include "srne_link_stats.h"
+#include <atomic>
+
+// --- Module-level (static) variables ---
+struct AtomicLinkCounters {
+    std::atomic<uint32_t> attempts;
+    std::atomic<uint32_t> successes;
+    std::atomic<uint32_t> timeouts;
+    std::atomic<uint32_t> crc_errors;
+    std::atomic<uint32_t> framing_errors;
+    std::atomic<uint32_t> exceptions;
+    std::atomic<uint32_t> retries;
+};
+
+struct FunctionSlot {
+    AtomicLinkCounters counters;
+    std::atomic<uint32_t> latency_histogram[SRNE_LATENCY_BUCKETS];
+};
+
+struct RegisterSlot {
+    std::atomic<uint32_t> key; // start_address + 1, 0 = free
+    AtomicLinkCounters counters;
+};
+
+static const uint8_t FUNCTION_CODES[SRNE_LINK_FUNCTION_COUNT] = {0x03, 0x06, 0x10};
+static FunctionSlot function_slots[SRNE_LINK_FUNCTION_COUNT];
+static RegisterSlot register_slots[SRNE_LINK_REGISTER_SLOTS];
+
+// --- Private Function Prototypes ---
+static void bump(std::atomic<uint32_t> &counter);
+static void recordResult(AtomicLinkCounters &counters, esp_err_t result, bool is_retry);
+static void copyCounters(const AtomicLinkCounters &from, SrneLinkCounters *to);
+static RegisterSlot *registerSlot(uint16_t start_address);
+
+// --- Public Function Implementations ---
+
+void srneLinkRecordAttempt(uint8_t function_code, uint16_t start_address, esp_err_t result, uint32_t latency_us, bool is_retry)
+{
+    for (uint8_t i = 0; i < SRNE_LINK_FUNCTION_COUNT; i++)
+    {
+        if (FUNCTION_CODES[i] != function_code) continue;
+
+        FunctionSlot &slot = function_slots[i];
+        recordResult(slot.counters, result, is_retry);
+        if (result == ESP_OK)
+        {
+            uint32_t latency_ms = latency_us / 1000;
+            uint8_t bucket = 0;
+            while (bucket < SRNE_LATENCY_BUCKETS - 1 && latency_ms >= SRNE_LATENCY_BUCKET_MS[bucket]) bucket++;
+            bump(slot.latency_histogram[bucket]);
+        }
+        break;
+    }
+
+    RegisterSlot *slot = registerSlot(start_address);
+    if (slot != NULL) recordResult(slot->counters, result, is_retry);
+}
+
+uint8_t srneLinkStatsSnapshot(SrneFunctionStats *functions, SrneRegisterStats *registers, uint8_t max_registers)
+{
+    for (uint8_t i = 0; i < SRNE_LINK_FUNCTION_COUNT; i++)
+    {
+        functions[i].function_code = FUNCTION_CODES[i];
+        copyCounters(function_slots[i].counters, &functions[i].counters);
+        for (uint8_t b = 0; b < SRNE_LATENCY_BUCKETS; b++)
+        {
+            functions[i].latency_histogram[b] = function_slots[i].latency_histogram[b].load(std::memory_order_relaxed);
+        }
+    }
+
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < SRNE_LINK_REGISTER_SLOTS && count < max_registers; i++)
+    {
+        uint32_t key = register_slots[i].key.load(std::memory_order_acquire);
+        if (key == 0) continue;
+        registers[count].start_address = key - 1;
+        copyCounters(register_slots[i].counters, &registers[count].counters);
+        count++;
+    }
+    return count;
+}
+
+// --- Private Function Implementations ---
+
+static void bump(std::atomic<uint32_t> &counter)
+{
+    counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void recordResult(AtomicLinkCounters &counters, esp_err_t result, bool is_retry)
+{
+    bump(counters.attempts);
+    if (is_retry) bump(counters.retries);
+
+    switch (result)
+    {
+        case ESP_OK:                   bump(counters.successes); break;
+        case ESP_ERR_TIMEOUT:          bump(counters.timeouts); break;
+        case ESP_ERR_INVALID_CRC:      bump(counters.crc_errors); break;
+        case ESP_ERR_INVALID_RESPONSE: bump(counters.exceptions); break;
+        default:                       bump(counters.framing_errors); break;
+    }
+}
+
+static void copyCounters(const AtomicLinkCounters &from, SrneLinkCounters *to)
+{
+    to->attempts = from.attempts.load(std::memory_order_relaxed);
+    to->successes = from.successes.load(std::memory_order_relaxed);
+    to->timeouts = from.timeouts.load(std::memory_order_relaxed);
+    to->crc_errors = from.crc_errors.load(std::memory_order_relaxed);
+    to->framing_errors = from.framing_errors.load(std::memory_order_relaxed);
+    to->exceptions = from.exceptions.load(std::memory_order_relaxed);
+    to->retries = from.retries.load(std::memory_order_relaxed);
+}
+
+// Open-addressed lookup by start address. Only the bus task inserts, so claiming a free slot
+// needs no compare-and-swap; the release store publishes it to snapshot readers.
+static RegisterSlot *registerSlot(uint16_t start_address)
+{
+    const uint32_t key = (uint32_t)start_address + 1;
+    uint8_t index = (start_address ^ (start_address >> 5)) % SRNE_LINK_REGISTER_SLOTS;
+
+    for (uint8_t probe = 0; probe < SRNE_LINK_REGISTER_SLOTS; probe++)
+    {
+        RegisterSlot &slot = register_slots[index];
+        uint32_t current = slot.key.load(std::memory_order_relaxed);
+        if (current == key) return &slot;
+        if (current == 0)
+        {
+            slot.key.store(key, std::memory_order_release);
+            return &slot;
+        }
+        index = (index + 1) % SRNE_LINK_REGISTER_SLOTS;
+    }
+    return NULL; // Table full: the per-function counters still see the attempt
+}
@@ -0,0 +1,201 @@
+// FILE: telemetry_codec.cpp
+
+#include "telemetry_codec.h"
+#include <math.h>
+
+// --- Module-level (static) variables ---
+// Order and scaling match the version 1 record in telemetry_codec.h
+const TelemetryColumn TELEMETRY_COLUMNS[] = {
+    {"lv",   ColumnType::U16, 100, [](const TelemetrySnapshot &t) { return t.load.load_voltage; }},
+    {"lc",   ColumnType::U16, 100, [](const TelemetrySnapshot &t) { return t.load.load_current; }},
+    {"lp",   ColumnType::U16, 1,   [](const TelemetrySnapshot &t) { return (float)t.load.load_power; }},
+    {"lw",   ColumnType::U32, 1,   [](const TelemetrySnapshot &t) { return (float)t.load.load_wh; }},
+    {"sv",   ColumnType::U16, 100, [](const TelemetrySnapshot &t) { return t.solar.solar_voltage; }},
+    {"sc",   ColumnType::U16, 100, [](const TelemetrySnapshot &t) { return t.solar.solar_current; }},
+    {"sp",   ColumnType::U16, 1,   [](const TelemetrySnapshot &t) { return (float)t.solar.solar_power; }},
+    {"bv",   ColumnType::U16, 100, [](const TelemetrySnapshot &t) { return t.battery.battery_voltage; }},
+    {"bc",   ColumnType::I16, 100, [](const TelemetrySnapshot &t) { return t.battery.battery_current; }},
+    {"bs",   ColumnType::U8,  1,   [](const TelemetrySnapshot &t) { return (float)t.battery.battery_soc; }},
+    {"bt",   ColumnType::I8,  1,   [](const TelemetrySnapshot &t) { return (float)t.battery.battery_temperature; }},
+    {"cw",   ColumnType::U32, 1,   [](const TelemetrySnapshot &t) { return (float)t.battery.charge_wh; }},
+    {"bse",  ColumnType::U16, 10,  [](const TelemetrySnapshot &t) { return t.battery.battery_soc_estimated; }},
+    {"tcah", ColumnType::U32, 1,   [](const TelemetrySnapshot &t) { return (float)t.battery.total_charge_ah; }},
+    {"tdah", ColumnType::U32, 1,   [](const TelemetrySnapshot &t) { return (float)t.battery.total_discharge_ah; }},
+};
+const uint8_t TELEMETRY_COLUMN_COUNT = sizeof(TELEMETRY_COLUMNS) / sizeof(TELEMETRY_COLUMNS[0]);
+
+// --- Private Function Prototypes ---
+static uint8_t *putU8(uint8_t *out, uint8_t value);
+static uint8_t *putU16(uint8_t *out, uint16_t value);
+static uint8_t *putU32(uint8_t *out, uint32_t value);
+static uint16_t scaledU16(float value, float scale);
+static int16_t scaledI16(float value, float scale);
+static int32_t scaledI32(float value, float scale);
+static uint8_t *putColumnValue(uint8_t *out, const TelemetryColumn &column, float value);
+static size_t columnSize(ColumnType type);
+static uint8_t *putEnergyTotals(uint8_t *out, const energyDataPack &energy_data);
+
+// --- Public Function Implementations ---
+
+size_t encodeTelemetryBinary(const TelemetrySnapshot &snapshot, bool replayed, uint8_t *out)
+{
+    uint8_t *p = out;
+
+    p = putU8(p, TELEMETRY_BINARY_VERSION);
+    p = putU8(p, replayed ? TELEMETRY_FLAG_REPLAYED : 0);
+    p = putU32(p, telemetryEpochSeconds(snapshot.time));
+
+    // Version 1 is a batch of one without the time offsets: same columns, same order
+    for (uint8_t c = 0; c < TELEMETRY_COLUMN_COUNT; c++)
+    {
+        p = putColumnValue(p, TELEMETRY_COLUMNS[c], TELEMETRY_COLUMNS[c].read(snapshot));
+    }
+
+    p = putEnergyTotals(p, snapshot.energy);
+
+    return p - out; // TELEMETRY_BINARY_SIZE
+}
+
+size_t telemetryBatchBinarySize(uint8_t count)
+{
+    size_t sample_size = 2; // Time offset
+    for (uint8_t c = 0; c < TELEMETRY_COLUMN_COUNT; c++)
+    {
+        sample_size += columnSize(TELEMETRY_COLUMNS[c].type);
+    }
+    return 7 + count * sample_size + 24;
+}
+
+size_t encodeTelemetryBatchBinary(const TelemetrySnapshot *samples, uint8_t count, uint8_t *out)
+{
+    uint8_t *p = out;
+    uint32_t base = count ? telemetryEpochSeconds(samples[0].time) : 0;
+
+    p = putU8(p, TELEMETRY_BATCH_VERSION);
+    p = putU8(p, 0);
+    p = putU8(p, count);
+    p = putU32(p, base);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        int32_t offset = (int32_t)(telemetryEpochSeconds(samples[i].time) - base);
+        p = putU16(p, (uint16_t)constrain(offset, 0, (int32_t)UINT16_MAX)); // The RTC can step backwards when set
+    }
+
+    for (uint8_t c = 0; c < TELEMETRY_COLUMN_COUNT; c++)
+    {
+        for (uint8_t i = 0; i < count; i++)
+        {
+            p = putColumnValue(p, TELEMETRY_COLUMNS[c], TELEMETRY_COLUMNS[c].read(samples[i]));
+        }
+    }
+
+    const energyDataPack no_energy = {};
+    p = putEnergyTotals(p, count ? samples[count - 1].energy : no_energy);
+    return p - out;
+}
+
+const char *wireFormatSuffix(WireFormat format)
+{
+    switch (format)
+    {
+        case WireFormat::MSGPACK: return "/mp";
+        case WireFormat::BINARY:  return "/bin";
+        default:                  return "";
+    }
+}
+
+// Days-from-civil (proleptic Gregorian), valid for the RTC's 2000-2099 range
+uint32_t telemetryEpochSeconds(const timeDataPack &time_data)
+{
+    int year = time_data.year;
+    int month = time_data.month;
+    if (month <= 2) year--;
+    int era_year = year - 1600; // 1600 starts a 400-year era, keeping everything non-negative
+    int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + time_data.day - 1;
+    int day_of_era = (era_year % 400) * 365 + (era_year % 400) / 4 - (era_year % 400) / 100 + day_of_year;
+    int32_t days = (era_year / 400) * 146097 + day_of_era - 135080; // 135080 = days from 1600-03-01 to 1970-01-01
+
+    return (uint32_t)days * 86400UL + time_data.hour * 3600UL + time_data.minute * 60UL + time_data.second;
+}
+
+// --- Private Function Implementations ---
+
+static uint8_t *putU8(uint8_t *out, uint8_t value)
+{
+    *out = value;
+    return out + 1;
+}
+
+static uint8_t *putU16(uint8_t *out, uint16_t value)
+{
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+    return out + 2;
+}
+
+static uint8_t *putU32(uint8_t *out, uint32_t value)
+{
+    out = putU16(out, value & 0xFFFF);
+    return putU16(out, value >> 16);
+}
+
+static uint16_t scaledU16(float value, float scale)
+{
+    float scaled = roundf(value * scale);
+    if (!(scaled > 0)) return 0; // Also catches NaN
+    return scaled >= UINT16_MAX ? UINT16_MAX : (uint16_t)scaled;
+}
+
+static int16_t scaledI16(float value, float scale)
+{
+    float scaled = roundf(value * scale);
+    if (scaled != scaled) return 0;
+    if (scaled <= INT16_MIN) return INT16_MIN;
+    return scaled >= INT16_MAX ? INT16_MAX : (int16_t)scaled;
+}
+
+static int32_t scaledI32(float value, float scale)
+{
+    double scaled = round((double)value * scale);
+    if (scaled != scaled) return 0;
+    if (scaled <= INT32_MIN) return INT32_MIN;
+    return scaled >= INT32_MAX ? INT32_MAX : (int32_t)scaled;
+}
+
+static uint8_t *putColumnValue(uint8_t *out, const TelemetryColumn &column, float value)
+{
+    switch (column.type)
+    {
+        case ColumnType::U8:  return putU8(out, (uint8_t)constrain(lroundf(value * column.scale), 0L, 255L));
+        case ColumnType::I8:  return putU8(out, (uint8_t)(int8_t)constrain(lroundf(value * column.scale), -128L, 127L));
+        case ColumnType::U16: return putU16(out, scaledU16(value, column.scale));
+        case ColumnType::I16: return putU16(out, (uint16_t)scaledI16(value, column.scale));
+        case ColumnType::U32: return putU32(out, (uint32_t)value);
+    }
+    return out;
+}
+
+static size_t columnSize(ColumnType type)
+{
+    switch (type)
+    {
+        case ColumnType::U8:
+        case ColumnType::I8:  return 1;
+        case ColumnType::U16:
+        case ColumnType::I16: return 2;
+        case ColumnType::U32: return 4;
+    }
+    return 0;
+}
+
+static uint8_t *putEnergyTotals(uint8_t *out, const energyDataPack &energy_data)
+{
+    const float energy[] = {energy_data.new_wh, energy_data.new_wh_e, energy_data.full_wh,
+                            energy_data.full_wh_e, energy_data.current_energy, energy_data.current_energy_e};
+    for (size_t i = 0; i < sizeof(energy) / sizeof(energy[0]); i++)
+    {
+        out = putU32(out, (uint32_t)scaledI32(energy[i], 100));
+    }
+    return out;
+}
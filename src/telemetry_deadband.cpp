@@ -0,0 +1,130 @@
+// FILE: telemetry_deadband.cpp
+
+#include "telemetry_deadband.h"
+#include "esp_timer.h"
+#include <atomic>
+#include <math.h>
+
+// --- Module-level (static) variables ---
+// Defaults skip sensor noise but pass anything a dashboard would show
+static DeadbandField fields[] = {
+    {"lv",   0.01f, 10, 0}, // 0.10 V
+    {"lc",   0.01f, 5,  0}, // 0.05 A
+    {"lp",   1.0f,  2,  0},
+    {"lw",   1.0f,  1,  0},
+    {"sv",   0.01f, 20, 0},
+    {"sc",   0.01f, 5,  0},
+    {"sp",   1.0f,  2,  0},
+    {"bv",   0.01f, 2,  0},
+    {"bc",   0.01f, 5,  0},
+    {"bs",   1.0f,  1,  0},
+    {"bt",   1.0f,  1,  0},
+    {"cw",   1.0f,  1,  0},
+    {"bse",  0.1f,  5,  0},
+    {"tcah", 1.0f,  1,  0},
+    {"tdah", 1.0f,  1,  0},
+    {"nw",   0.01f, 10, 0},
+    {"nwe",  0.01f, 10, 0},
+    {"fwh",  0.01f, 10, 0},
+    {"fwe",  0.01f, 10, 0},
+    {"ce",   0.01f, 10, 0},
+    {"cee",  0.01f, 10, 0},
+};
+static const uint8_t FIELD_COUNT = sizeof(fields) / sizeof(fields[0]);
+
+static std::atomic<uint8_t> keyframe_minutes(0);
+static std::atomic<bool> force_keyframe(true); // Set from any task, cleared by the publisher
+
+// Publisher task only
+static float reported[FIELD_COUNT]; // Last value the broker accepted, per field
+static float staged[FIELD_COUNT];   // Values in the message being published
+static bool staged_sent[FIELD_COUNT];
+static bool staged_keyframe = false;
+static int64_t last_keyframe_us = 0;
+
+// --- Private Function Prototypes ---
+static bool fieldChanged(const DeadbandField &field, float value, float reference);
+
+// --- Public Function Implementations ---
+
+void setReportByException(uint8_t minutes)
+{
+    keyframe_minutes.store(minutes, std::memory_order_relaxed);
+    force_keyframe.store(true, std::memory_order_relaxed);
+}
+
+bool reportByExceptionEnabled()
+{
+    return keyframe_minutes.load(std::memory_order_relaxed) > 0;
+}
+
+esp_err_t setDeadband(uint8_t field, uint8_t absolute, uint8_t relative_pct)
+{
+    if (field >= FIELD_COUNT || relative_pct > 100) return ESP_ERR_INVALID_ARG;
+
+    fields[field].absolute = absolute;
+    fields[field].relative_pct = relative_pct;
+    force_keyframe.store(true, std::memory_order_relaxed);
+    return ESP_OK;
+}
+
+const DeadbandField *deadbandFields(uint8_t *count)
+{
+    *count = FIELD_COUNT;
+    return fields;
+}
+
+bool deadbandFilter(JsonDocument &doc)
+{
+    int64_t now_us = esp_timer_get_time();
+    int64_t keyframe_interval_us = (int64_t)keyframe_minutes.load(std::memory_order_relaxed) * 60 * 1000000;
+
+    staged_keyframe = force_keyframe.exchange(false, std::memory_order_relaxed) || now_us - last_keyframe_us >= keyframe_interval_us;
+
+    for (uint8_t i = 0; i < FIELD_COUNT; i++)
+    {
+        staged_sent[i] = false;
+        JsonVariant value = doc[fields[i].key];
+        if (value.isNull()) continue;
+
+        staged[i] = value.as<float>();
+        if (staged_keyframe || fieldChanged(fields[i], staged[i], reported[i]))
+        {
+            staged_sent[i] = true;
+        }
+        else
+        {
+            doc.remove(fields[i].key);
+        }
+    }
+
+    return staged_keyframe;
+}
+
+void deadbandCommit(bool published)
+{
+    if (!published)
+    {
+        // The broker may have lost any of the recent deltas
+        force_keyframe.store(true, std::memory_order_relaxed);
+        return;
+    }
+
+    for (uint8_t i = 0; i < FIELD_COUNT; i++)
+    {
+        if (staged_sent[i]) reported[i] = staged[i];
+    }
+    if (staged_keyframe) last_keyframe_us = esp_timer_get_time();
+}
+
+// --- Private Function Implementations ---
+
+// Compared with the last reported value, not the last sample, so a slow drift is still sent once
+// it adds up to a full deadband
+static bool fieldChanged(const DeadbandField &field, float value, float reference)
+{
+    float delta = fabsf(value - reference);
+    if (delta != delta) return true; // NaN on either side
+    float threshold = fmaxf(field.absolute * field.resolution, fabsf(reference) * field.relative_pct / 100.0f);
+    return delta > 0 && delta >= threshold - field.resolution * 0.001f; // Tolerate float rounding at the boundary
+}
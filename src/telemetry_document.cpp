@@ -0,0 +1,251 @@
+// FILE: telemetry_document.cpp
+
+#include "telemetry_document.h"
+#include "srne_link_stats.h"
+#include "scheduler.h"
+#include "runtime_profile.h"
+#include "telemetry_outbox.h"
+#include "telemetry_codec.h"
+#include "telemetry_deadband.h"
+#include "json_arena.h"
+#include <math.h>
+
+// --- Module-level (static) variables ---
+static const uint8_t LINK_STATS_MAX_REGISTERS = 6; // Only registers with failures are published
+
+// --- Private Function Prototypes ---
+static void appendLinkCounters(JsonObject obj, const SrneLinkCounters &counters);
+static void appendLinkStats(JsonDocument &doc);
+static void appendJobTiming(JsonDocument &doc);
+static uint32_t appendRuntimeProfile(JsonDocument &doc, uint32_t last_sampled_ms);
+static void appendOutboxStats(JsonDocument &doc);
+static void appendArenaStats(JsonDocument &doc);
+static void appendPublishHeapStats(JsonDocument &doc, const PublishHeapStats &stats);
+static void appendEnergyTotals(JsonDocument &doc, const energyDataPack &energy_data);
+
+// --- Public Function Implementations ---
+
+bool buildTelemetryDocument(JsonDocument &doc, const TelemetrySnapshot &snapshot, bool replayed)
+{
+    const loadDataPack &load_data = snapshot.load;
+    const solarDataPack &solar_data = snapshot.solar;
+    const batteryDataPack &battery_data = snapshot.battery;
+    const timeDataPack &time_data = snapshot.time;
+
+    doc["lv"] = load_data.load_voltage;
+    doc["lc"] = load_data.load_current;
+    doc["lp"] = load_data.load_power;
+    doc["lw"] = load_data.load_wh;
+    doc["sv"] = solar_data.solar_voltage;
+    doc["sc"] = solar_data.solar_current;
+    doc["sp"] = solar_data.solar_power;
+    doc["bv"] = battery_data.battery_voltage;
+    doc["bc"] = battery_data.battery_current;
+    doc["bs"] = battery_data.battery_soc;
+    doc["bt"] = battery_data.battery_temperature;
+    doc["cw"] = battery_data.charge_wh; // Total Charge Wh (0x011C)
+    doc["bse"] = round(battery_data.battery_soc_estimated * 10) / 10.0;
+
+    // +++ START: เพิ่มค่าใหม่ลงใน JSON +++
+    doc["tcah"] = battery_data.total_charge_ah; // Total Charge Ah (0x0118)
+    doc["tdah"] = battery_data.total_discharge_ah; // Total Discharge Ah (0x011A)
+    // +++ END: เพิ่มค่าใหม่ลงใน JSON +++
+
+    appendEnergyTotals(doc, snapshot.energy);
+
+    // Replays stay complete: they fill gaps and are not part of the live delta stream
+    bool filtered = !replayed && reportByExceptionEnabled();
+    if (filtered && deadbandFilter(doc))
+    {
+        doc["kf"] = 1;
+    }
+
+    char timestamp[25];
+    snprintf(timestamp, sizeof(timestamp), "%04d-%02d-%02dT%02d:%02d:%02d",
+             time_data.year, time_data.month, time_data.day,
+             time_data.hour, time_data.minute, time_data.second);
+    doc["timestamp"] = timestamp;
+
+    if (replayed) doc["rp"] = 1;
+    return filtered;
+}
+
+void buildBatchDocument(JsonDocument &doc, const TelemetrySnapshot *samples, uint8_t count)
+{
+    uint32_t base = telemetryEpochSeconds(samples[0].time);
+    doc["n"] = count;
+    doc["t0"] = base;
+    JsonArray offsets = doc["dt"].to<JsonArray>();
+    for (uint8_t i = 0; i < count; i++)
+    {
+        offsets.add((int32_t)(telemetryEpochSeconds(samples[i].time) - base));
+    }
+
+    for (uint8_t c = 0; c < TELEMETRY_COLUMN_COUNT; c++)
+    {
+        const TelemetryColumn &column = TELEMETRY_COLUMNS[c];
+        JsonArray values = doc[column.key].to<JsonArray>();
+        for (uint8_t i = 0; i < count; i++)
+        {
+            float value = column.read(samples[i]);
+            if (column.scale == 1)
+            {
+                values.add((long)lroundf(value));
+            }
+            else
+            {
+                values.add((float)(round(value * column.scale) / column.scale)); // Prints as the double would, without an extra slot on 32-bit
+            }
+        }
+    }
+
+    appendEnergyTotals(doc, samples[count - 1].energy);
+}
+
+uint32_t buildDiagnosticsDocument(JsonDocument &doc, const PublishHeapStats &publish_heap, uint32_t profile_published_ms)
+{
+    appendLinkStats(doc);
+    appendJobTiming(doc);
+    appendOutboxStats(doc);
+    appendArenaStats(doc);
+    appendPublishHeapStats(doc, publish_heap);
+    return appendRuntimeProfile(doc, profile_published_ms);
+}
+
+// --- Private Function Implementations ---
+
+static void appendLinkCounters(JsonObject obj, const SrneLinkCounters &counters)
+{
+    obj["n"] = counters.attempts;
+    obj["ok"] = counters.successes;
+    obj["to"] = counters.timeouts;
+    obj["crc"] = counters.crc_errors;
+    obj["fe"] = counters.framing_errors;
+    obj["ex"] = counters.exceptions;
+    obj["rt"] = counters.retries;
+}
+
+// SRNE link health, on the diagnostics period: per function code counters plus a latency
+// histogram (bucket bounds in SRNE_LATENCY_BUCKET_MS) for the codes that have been used, and per
+// start address counters for the registers that have failed.
+static void appendLinkStats(JsonDocument &doc)
+{
+    SrneFunctionStats functions[SRNE_LINK_FUNCTION_COUNT];
+    SrneRegisterStats registers[SRNE_LINK_REGISTER_SLOTS];
+    uint8_t register_count = srneLinkStatsSnapshot(functions, registers, SRNE_LINK_REGISTER_SLOTS);
+
+    JsonObject link = doc["link"].to<JsonObject>();
+    for (uint8_t i = 0; i < SRNE_LINK_FUNCTION_COUNT; i++)
+    {
+        if (functions[i].counters.attempts == 0) continue; // Writes are rare
+
+        char key[8];
+        snprintf(key, sizeof(key), "fc%02X", functions[i].function_code);
+        JsonObject fc = link[key].to<JsonObject>();
+        appendLinkCounters(fc, functions[i].counters);
+
+        JsonArray histogram = fc["h"].to<JsonArray>();
+        for (uint8_t b = 0; b < SRNE_LATENCY_BUCKETS; b++)
+        {
+            histogram.add(functions[i].latency_histogram[b]);
+        }
+    }
+
+    uint8_t published = 0;
+    for (uint8_t i = 0; i < register_count && published < LINK_STATS_MAX_REGISTERS; i++)
+    {
+        if (registers[i].counters.successes == registers[i].counters.attempts) continue;
+
+        char key[8];
+        snprintf(key, sizeof(key), "%04X", registers[i].start_address);
+        if (published == 0) link["reg"].to<JsonObject>();
+        appendLinkCounters(link["reg"][key].to<JsonObject>(), registers[i].counters);
+        published++;
+    }
+}
+
+// Per job [worst-case run time (ms), deadline misses, skipped releases]; the full table with
+// jitter histograms is on the serial console
+static void appendJobTiming(JsonDocument &doc)
+{
+    uint8_t job_count;
+    const SchedulerJob *jobs = schedulerJobs(&job_count);
+
+    JsonObject timing = doc["jobs"].to<JsonObject>();
+    for (uint8_t i = 0; i < job_count; i++)
+    {
+        ExecTimingStats snapshot;
+        execTimingSnapshot(jobs[i].timing, &snapshot);
+        JsonArray job = timing[jobs[i].name].to<JsonArray>();
+        job.add(snapshot.max_us / 1000);
+        job.add(snapshot.deadline_misses);
+        job.add(jobs[i].skipped);
+    }
+}
+
+// Heap as [free, largest block, minimum ever] and every task as [CPU permille, free stack bytes]
+// Only a sample newer than last_sampled_ms is added; returns the one added, or 0
+static uint32_t appendRuntimeProfile(JsonDocument &doc, uint32_t last_sampled_ms)
+{
+    static RuntimeProfile profile; // Too large for the publisher's stack
+    runtimeProfileGet(&profile);
+    if (profile.sampled_ms == 0 || profile.sampled_ms == last_sampled_ms) return 0;
+
+    JsonObject runtime = doc["rt"].to<JsonObject>();
+    JsonArray heap = runtime["h"].to<JsonArray>();
+    heap.add(profile.heap_free_bytes);
+    heap.add(profile.heap_largest_block_bytes);
+    heap.add(profile.heap_min_free_bytes);
+
+    JsonObject tasks = runtime["t"].to<JsonObject>();
+    for (uint8_t i = 0; i < profile.task_count; i++)
+    {
+        JsonArray task = tasks[profile.tasks[i].name].to<JsonArray>();
+        task.add(profile.tasks[i].cpu_permille);
+        task.add(profile.tasks[i].stack_free_bytes);
+    }
+    return profile.sampled_ms;
+}
+
+static void appendOutboxStats(JsonDocument &doc)
+{
+    OutboxStats stats;
+    outboxGetStats(&stats);
+
+    JsonObject outbox = doc["ob"].to<JsonObject>();
+    outbox["p"] = stats.pending;
+    outbox["r"] = stats.replayed;
+    outbox["d"] = stats.dropped;
+    outbox["fe"] = stats.flash_errors;
+}
+
+// Document arena [high-water bytes, heap fallbacks]; fallbacks should stay at 0
+static void appendArenaStats(JsonDocument &doc)
+{
+    JsonArenaStats stats;
+    jsonArenaGetStats(&stats);
+
+    JsonArray arena = doc["ja"].to<JsonArray>();
+    arena.add(stats.high_water_bytes);
+    arena.add(stats.heap_fallbacks);
+}
+
+// Publish path heap [publishes checked, publishes over the allowance, worst excess bytes];
+// overruns should stay at 0
+static void appendPublishHeapStats(JsonDocument &doc, const PublishHeapStats &stats)
+{
+    JsonArray heap = doc["ph"].to<JsonArray>();
+    heap.add(stats.checks);
+    heap.add(stats.overruns);
+    heap.add(stats.worst_excess);
+}
+
+static void appendEnergyTotals(JsonDocument &doc, const energyDataPack &energy_data)
+{
+    doc["nw"] = round(energy_data.new_wh * 100) / 100.0;
+    doc["nwe"] = round(energy_data.new_wh_e * 100) / 100.0;
+    doc["fwh"] = round(energy_data.full_wh * 100) / 100.0;
+    doc["fwe"] = round(energy_data.full_wh_e * 100) / 100.0;
+    doc["ce"] = round(energy_data.current_energy * 100) / 100.0;
+    doc["cee"] = round(energy_data.current_energy_e * 100) / 100.0;
+}
@@ -0,0 +1,291 @@
+// FILE: telemetry_outbox.cpp
+
+#include "telemetry_outbox.h"
+#include "crc_utils.h"
+#include "esp_partition.h"
+
+// Flash log layout: fixed 128-byte slots, written in order around the partition. A sector is
+// erased when the head enters it, dropping any pending records still in it. Delivery clears the
+// slot's state byte in place (flash bits can only go from 1 to 0, which PENDING -> SENT does),
+// so after a reboot the pending records are exactly the PENDING slots with a valid CRC.
+struct FlashRecord {
+    uint8_t state;
+    uint8_t reserved[3];
+    uint32_t log_sequence;
+    uint32_t crc; // CRC-32 over log_sequence and snapshot
+    TelemetrySnapshot snapshot;
+};
+
+const uint32_t FLASH_SECTOR_SIZE = 4096;
+const uint32_t FLASH_SLOT_SIZE = 128;
+const uint32_t SLOTS_PER_SECTOR = FLASH_SECTOR_SIZE / FLASH_SLOT_SIZE;
+const uint8_t SLOT_ERASED = 0xFF;
+const uint8_t SLOT_PENDING = 0xA5;
+const uint8_t SLOT_SENT = 0x00;
+static_assert(sizeof(FlashRecord) <= FLASH_SLOT_SIZE, "FlashRecord must fit in one slot");
+
+// --- Module-level (static) variables ---
+static const esp_partition_t *log_partition = NULL;
+static uint32_t slot_count = 0;
+static uint32_t head_slot = 0;     // Next slot to write
+static uint32_t tail_slot = 0;     // Oldest pending record
+static uint32_t flash_pending = 0; // Slots from tail to head
+static uint32_t next_log_sequence = 1;
+static bool head_checked = false;
+
+static TelemetrySnapshot ram_ring[OUTBOX_RAM_RECORDS];
+static uint8_t ram_tail = 0;
+static uint8_t ram_count = 0;
+
+static bool peeked_from_flash = false;
+static OutboxStats stats = {};
+
+// --- Private Function Prototypes ---
+static void recoverFlashLog();
+static bool readSlot(uint32_t slot, FlashRecord *record);
+static uint32_t recordCrc(const FlashRecord &record);
+static void flashAppend(const TelemetrySnapshot &snapshot);
+static bool flashPeek(TelemetrySnapshot *snapshot);
+static void flashPop();
+
+// --- Public Function Implementations ---
+
+esp_err_t setupTelemetryOutbox()
+{
+    log_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, "spiffs");
+    if (log_partition == NULL || log_partition->size < 2 * FLASH_SECTOR_SIZE)
+    {
+        log_partition = NULL;
+        Serial.printf("⚠️ No outbox partition; buffering %d samples in RAM only.\n", OUTBOX_RAM_RECORDS);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    slot_count = (log_partition->size / FLASH_SECTOR_SIZE) * SLOTS_PER_SECTOR;
+    recoverFlashLog();
+
+    stats.flash_capacity = slot_count;
+    Serial.printf("📦 Outbox: %lu flash slots, %lu samples pending from before reboot.\n", (unsigned long)slot_count, (unsigned long)flash_pending);
+    return ESP_OK;
+}
+
+void outboxPush(const TelemetrySnapshot &snapshot)
+{
+    if (ram_count == OUTBOX_RAM_RECORDS)
+    {
+        if (log_partition != NULL)
+        {
+            // Spill the whole ring in one go so the flash is touched once per OUTBOX_RAM_RECORDS
+            for (uint8_t i = 0; i < ram_count; i++)
+            {
+                flashAppend(ram_ring[(ram_tail + i) % OUTBOX_RAM_RECORDS]);
+            }
+            ram_tail = 0;
+            ram_count = 0;
+        }
+        else
+        {
+            ram_tail = (ram_tail + 1) % OUTBOX_RAM_RECORDS;
+            ram_count--;
+            stats.dropped++;
+        }
+    }
+
+    ram_ring[(ram_tail + ram_count) % OUTBOX_RAM_RECORDS] = snapshot;
+    ram_count++;
+}
+
+bool outboxPeek(TelemetrySnapshot *snapshot)
+{
+    // Flash holds only records older than anything in RAM
+    if (flashPeek(snapshot))
+    {
+        peeked_from_flash = true;
+        return true;
+    }
+    if (ram_count == 0) return false;
+
+    *snapshot = ram_ring[ram_tail];
+    peeked_from_flash = false;
+    return true;
+}
+
+void outboxPop()
+{
+    if (peeked_from_flash)
+    {
+        flashPop();
+    }
+    else if (ram_count > 0)
+    {
+        ram_tail = (ram_tail + 1) % OUTBOX_RAM_RECORDS;
+        ram_count--;
+    }
+    stats.replayed++;
+}
+
+uint32_t outboxPending()
+{
+    return flash_pending + ram_count;
+}
+
+void outboxGetStats(OutboxStats *out)
+{
+    *out = stats;
+    out->pending = outboxPending();
+}
+
+// --- Private Function Implementations ---
+
+// Finds the newest record (the head follows it) and the oldest PENDING one (the tail). Sectors
+// holding data that is not ours, e.g. an old SPIFFS image, are erased.
+static void recoverFlashLog()
+{
+    bool found = false;
+    uint32_t newest_sequence = 0, newest_slot = 0;
+    bool found_pending = false;
+    uint32_t oldest_pending_sequence = 0, oldest_pending_slot = 0;
+    FlashRecord record;
+
+    for (uint32_t sector = 0; sector < slot_count / SLOTS_PER_SECTOR; sector++)
+    {
+        bool sector_has_records = false;
+        bool sector_has_foreign = false;
+
+        for (uint32_t slot = sector * SLOTS_PER_SECTOR; slot < (sector + 1) * SLOTS_PER_SECTOR; slot++)
+        {
+            if (!readSlot(slot, &record))
+            {
+                if (record.state != SLOT_ERASED) sector_has_foreign = true;
+                continue;
+            }
+
+            sector_has_records = true;
+            if (!found || (int32_t)(record.log_sequence - newest_sequence) > 0)
+            {
+                found = true;
+                newest_sequence = record.log_sequence;
+                newest_slot = slot;
+            }
+            if (record.state == SLOT_PENDING && (!found_pending || (int32_t)(record.log_sequence - oldest_pending_sequence) < 0))
+            {
+                found_pending = true;
+                oldest_pending_sequence = record.log_sequence;
+                oldest_pending_slot = slot;
+            }
+        }
+
+        if (sector_has_foreign && !sector_has_records)
+        {
+            esp_partition_erase_range(log_partition, sector * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+        }
+    }
+
+    head_slot = found ? (newest_slot + 1) % slot_count : 0;
+    next_log_sequence = found ? newest_sequence + 1 : 1;
+    tail_slot = found_pending ? oldest_pending_slot : head_slot;
+    flash_pending = (head_slot + slot_count - tail_slot) % slot_count;
+    if (found_pending && flash_pending == 0) flash_pending = slot_count; // Every slot pending
+    head_checked = false;
+}
+
+// True for a PENDING or SENT slot with a valid CRC; record->state is always filled in
+static bool readSlot(uint32_t slot, FlashRecord *record)
+{
+    if (esp_partition_read(log_partition, slot * FLASH_SLOT_SIZE, record, sizeof(FlashRecord)) != ESP_OK)
+    {
+        record->state = SLOT_ERASED;
+        return false;
+    }
+    if (record->state != SLOT_PENDING && record->state != SLOT_SENT) return false;
+    return recordCrc(*record) == record->crc;
+}
+
+static uint32_t recordCrc(const FlashRecord &record)
+{
+    uint32_t crc = crc32((const uint8_t *)&record.log_sequence, sizeof(record.log_sequence));
+    return crc32Update(crc, (const uint8_t *)&record.snapshot, sizeof(record.snapshot));
+}
+
+static void flashAppend(const TelemetrySnapshot &snapshot)
+{
+    // After a reboot the slot after the newest record may hold a torn write; start a fresh sector
+    if (!head_checked)
+    {
+        head_checked = true;
+        uint8_t state = SLOT_ERASED;
+        esp_partition_read(log_partition, head_slot * FLASH_SLOT_SIZE, &state, 1);
+        if (state != SLOT_ERASED && head_slot % SLOTS_PER_SECTOR != 0)
+        {
+            uint32_t next_sector_slot = (head_slot / SLOTS_PER_SECTOR + 1) * SLOTS_PER_SECTOR % slot_count;
+            if (flash_pending > 0) flash_pending += (next_sector_slot + slot_count - head_slot) % slot_count;
+            head_slot = next_sector_slot;
+        }
+    }
+
+    if (flash_pending == 0) tail_slot = head_slot;
+
+    if (head_slot % SLOTS_PER_SECTOR == 0)
+    {
+        // Log full: the oldest records share the sector about to be erased
+        uint32_t sector = head_slot / SLOTS_PER_SECTOR;
+        while (flash_pending > 0 && tail_slot / SLOTS_PER_SECTOR == sector)
+        {
+            tail_slot = (tail_slot + 1) % slot_count;
+            flash_pending--;
+            stats.dropped++;
+        }
+        if (esp_partition_erase_range(log_partition, sector * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE) != ESP_OK)
+        {
+            stats.flash_errors++;
+            stats.dropped++;
+            return;
+        }
+        if (flash_pending == 0) tail_slot = head_slot;
+    }
+
+    static FlashRecord record; // Publisher task only; keeps 128 bytes off its stack
+    memset(&record, 0xFF, sizeof(record));
+    record.state = SLOT_PENDING;
+    record.log_sequence = next_log_sequence++;
+    record.snapshot = snapshot;
+    record.crc = recordCrc(record);
+
+    if (esp_partition_write(log_partition, head_slot * FLASH_SLOT_SIZE, &record, sizeof(record)) != ESP_OK)
+    {
+        stats.flash_errors++;
+        stats.dropped++;
+    }
+
+    // A failed slot still advances the head; flashPeek() skips it
+    head_slot = (head_slot + 1) % slot_count;
+    flash_pending++;
+}
+
+static bool flashPeek(TelemetrySnapshot *snapshot)
+{
+    static FlashRecord record;
+
+    while (flash_pending > 0)
+    {
+        if (readSlot(tail_slot, &record) && record.state == SLOT_PENDING)
+        {
+            *snapshot = record.snapshot;
+            return true;
+        }
+
+        // Torn or failed write: nothing to deliver in this slot
+        tail_slot = (tail_slot + 1) % slot_count;
+        flash_pending--;
+    }
+    return false;
+}
+
+static void flashPop()
+{
+    if (flash_pending == 0) return;
+
+    uint8_t sent = SLOT_SENT;
+    if (esp_partition_write(log_partition, tail_slot * FLASH_SLOT_SIZE, &sent, 1) != ESP_OK) stats.flash_errors++;
+    tail_slot = (tail_slot + 1) % slot_count;
+    flash_pending--;
+}
@@ -0,0 +1,263 @@
+// FILE: telemetry_pipeline.cpp
+
+#include "telemetry_pipeline.h"
+#include "connectivity_ota.h"
+#include "boot_trace.h"
+#include "telemetry_outbox.h"
+#include "threshold_monitor.h"
+#include <atomic>
+
+static_assert((TELEMETRY_RING_SIZE & (TELEMETRY_RING_SIZE - 1)) == 0, "TELEMETRY_RING_SIZE must be a power of two");
+
+// --- Module-level (static) variables ---
+// head is written only by the producer and tail only by the consumer; each side publishes its
+// index with a release store after touching the slot and reads the other side's with acquire.
+static TelemetrySnapshot ring[TELEMETRY_RING_SIZE];
+static std::atomic<uint32_t> ring_head(0);
+static std::atomic<uint32_t> ring_tail(0);
+static std::atomic<uint32_t> ring_dropped(0);
+
+static TaskHandle_t publisher_task = NULL;
+static std::atomic<uint32_t> publish_period(0);
+static const char *topic = NULL;
+static char boot_topic[64];
+static const uint8_t OUTBOX_REPLAY_BATCH = 5;          // Records per replay round
+static const uint32_t OUTBOX_REPLAY_INTERVAL_MS = 1000; // Between replay rounds, to spare the broker
+static const uint32_t PUBLISH_DEADLINE_US = 1000000;    // Half the acquisition period
+static ExecTimingStats publish_timing = {"publish", 0, PUBLISH_DEADLINE_US};
+
+// Batch policy packed as max_samples | max_age_s << 8 | flush_on_alarm << 24, so the command task
+// can replace it in one store
+static std::atomic<uint32_t> batch_policy(0);
+static TelemetrySnapshot batch[TELEMETRY_BATCH_MAX_SAMPLES];
+static uint8_t batch_count = 0;
+
+// --- Private Function Prototypes ---
+static bool popSnapshot(TelemetrySnapshot *snapshot);
+static void publisherTask(void *parameter);
+static bool publishSnapshot(const TelemetrySnapshot &snapshot, bool replayed);
+static void replayOutbox();
+static BatchPolicy loadBatchPolicy();
+static bool alarmRaised();
+static void flushBatch();
+
+// --- Public Function Implementations ---
+
+esp_err_t startTelemetryPipeline(uint32_t publish_period_ms, const char *publish_topic)
+{
+    publish_period.store(publish_period_ms, std::memory_order_relaxed);
+    topic = publish_topic;
+    snprintf(boot_topic, sizeof(boot_topic), "%s/boot", publish_topic);
+
+    if (xTaskCreatePinnedToCore(publisherTask, "PublisherTask", 8192, NULL, 3, &publisher_task, 0) != pdPASS)
+    {
+        Serial.println("❌ Failed to start telemetry publisher task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void setPublishPeriod(uint32_t publish_period_ms)
+{
+    publish_period.store(publish_period_ms, std::memory_order_relaxed);
+}
+
+void setBatchPolicy(const BatchPolicy &policy)
+{
+    uint8_t samples = policy.max_samples > TELEMETRY_BATCH_MAX_SAMPLES ? TELEMETRY_BATCH_MAX_SAMPLES : policy.max_samples;
+    batch_policy.store(samples | (uint32_t)policy.max_age_s << 8 | (uint32_t)policy.flush_on_alarm << 24, std::memory_order_relaxed);
+    if (publisher_task != NULL) xTaskNotifyGive(publisher_task);
+}
+
+bool submitTelemetrySnapshot(const TelemetrySnapshot &snapshot)
+{
+    uint32_t head = ring_head.load(std::memory_order_relaxed);
+    if (head - ring_tail.load(std::memory_order_acquire) >= TELEMETRY_RING_SIZE)
+    {
+        ring_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    ring[head & (TELEMETRY_RING_SIZE - 1)] = snapshot;
+    ring_head.store(head + 1, std::memory_order_release);
+
+    if (publisher_task != NULL) xTaskNotifyGive(publisher_task);
+    return true;
+}
+
+uint32_t telemetrySnapshotsDropped()
+{
+    return ring_dropped.load(std::memory_order_relaxed);
+}
+
+void publishTimingPrint()
+{
+    const ExecTimingStats *timings[1] = {&publish_timing};
+    execTimingPrint(timings, 1);
+}
+
+// --- Private Function Implementations ---
+
+static bool popSnapshot(TelemetrySnapshot *snapshot)
+{
+    uint32_t tail = ring_tail.load(std::memory_order_relaxed);
+    if (tail == ring_head.load(std::memory_order_acquire)) return false;
+
+    *snapshot = ring[tail & (TELEMETRY_RING_SIZE - 1)];
+    ring_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+// Drains the ring on every new snapshot and publishes the newest one once per publish period, or
+// in batching mode collects every snapshot and flushes them together. Samples that cannot go out
+// are queued in the outbox and replayed oldest first in small batches once the MQTT session is back.
+static void publisherTask(void *parameter)
+{
+    setupTelemetryOutbox(); // Scans the flash log here, off the boot path
+
+    TelemetrySnapshot latest;
+    bool have_latest = false;
+    TickType_t last_publish = xTaskGetTickCount() - pdMS_TO_TICKS(publish_period.load(std::memory_order_relaxed));
+    TickType_t last_replay = 0;
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+
+        BatchPolicy policy = loadBatchPolicy();
+        bool batching = policy.max_samples > 1;
+
+        while (popSnapshot(&latest))
+        {
+            if (!batching)
+            {
+                have_latest = true;
+                continue;
+            }
+            batch[batch_count++] = latest;
+            if (batch_count >= policy.max_samples) flushBatch();
+        }
+
+        bool alarm = alarmRaised();
+        if (batch_count > 0)
+        {
+            bool too_old = esp_timer_get_time() - batch[0].captured_us >= (int64_t)policy.max_age_s * 1000000;
+            if (!batching || too_old || (alarm && policy.flush_on_alarm)) flushBatch();
+        }
+
+        TickType_t period = pdMS_TO_TICKS(publish_period.load(std::memory_order_relaxed));
+        if (!batching && have_latest && xTaskGetTickCount() - last_publish >= period)
+        {
+            last_publish = xTaskGetTickCount();
+            have_latest = false;
+
+            // Anything already queued is older, so a live sample waits its turn behind it
+            if (outboxPending() > 0 || !mqttLinkUp() || !publishSnapshot(latest, false))
+            {
+                outboxPush(latest);
+                Serial.printf("📦 Sample #%lu queued (%lu pending)\n", (unsigned long)latest.sequence, (unsigned long)outboxPending());
+            }
+        }
+
+        if (outboxPending() > 0 && mqttLinkUp() && xTaskGetTickCount() - last_replay >= pdMS_TO_TICKS(OUTBOX_REPLAY_INTERVAL_MS))
+        {
+            last_replay = xTaskGetTickCount();
+            replayOutbox();
+        }
+    }
+}
+
+static bool publishSnapshot(const TelemetrySnapshot &snapshot, bool replayed)
+{
+    esp_err_t result;
+    {
+        ExecTimer timer(publish_timing);
+        result = publishData(snapshot, topic, replayed);
+    }
+    if (result != ESP_OK)
+    {
+        Serial.println("❌ MQTT Publish Failed");
+        return false;
+    }
+
+    static bool first_published = false;
+    if (!first_published)
+    {
+        first_published = true;
+        bootTraceMark("first_publish");
+        Serial.printf("🚀 First sample published %lu ms after power-on\n", (unsigned long)millis());
+        if (publishBootTrace(boot_topic) != ESP_OK) Serial.println("❌ Boot timeline publish failed");
+    }
+
+    if (!replayed) Serial.printf("✅ MQTT Publish Successful (sample #%lu)\n", (unsigned long)snapshot.sequence);
+    return true;
+}
+
+// Sends the collected batch as one message, or queues its samples in the outbox
+static void flushBatch()
+{
+    bool published = false;
+    if (outboxPending() == 0 && mqttLinkUp())
+    {
+        ExecTimer timer(publish_timing);
+        published = publishBatch(batch, batch_count, topic) == ESP_OK;
+    }
+
+    if (!published)
+    {
+        for (uint8_t i = 0; i < batch_count; i++)
+        {
+            outboxPush(batch[i]);
+        }
+        Serial.printf("📦 Batch of %u queued (%lu pending)\n", batch_count, (unsigned long)outboxPending());
+    }
+    else
+    {
+        Serial.printf("✅ MQTT Batch Published (%u samples, #%lu-#%lu)\n", batch_count,
+                      (unsigned long)batch[0].sequence, (unsigned long)batch[batch_count - 1].sequence);
+    }
+    batch_count = 0;
+}
+
+static BatchPolicy loadBatchPolicy()
+{
+    uint32_t packed = batch_policy.load(std::memory_order_relaxed);
+    BatchPolicy policy;
+    policy.max_samples = packed & 0xFF;
+    policy.max_age_s = (packed >> 8) & 0xFFFF;
+    policy.flush_on_alarm = (packed >> 24) & 0x01;
+    return policy;
+}
+
+// True once after any protection rule trips
+static bool alarmRaised()
+{
+    static uint32_t trips_seen = 0;
+
+    uint8_t count;
+    const ThresholdRule *rules = thresholdRules(&count);
+    uint32_t trips = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        trips += rules[i].trip_count;
+    }
+
+    bool raised = (trips != trips_seen);
+    trips_seen = trips;
+    return raised;
+}
+
+static void replayOutbox()
+{
+    TelemetrySnapshot snapshot;
+    uint8_t sent = 0;
+
+    while (sent < OUTBOX_REPLAY_BATCH && outboxPeek(&snapshot))
+    {
+        if (!publishSnapshot(snapshot, true)) break;
+        outboxPop();
+        sent++;
+    }
+
+    if (sent > 0) Serial.printf("📤 Replayed %u queued samples (%lu pending)\n", sent, (unsigned long)outboxPending());
+}
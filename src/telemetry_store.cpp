@@ -0,0 +1,45 @@
+// FILE: telemetry_store.cpp
+
+#include "telemetry_store.h"
+#include "esp_timer.h"
+#include <atomic>
+
+// --- Module-level (static) variables ---
+// An odd sequence means copies[0] is being written and readers use copies[1]; an even sequence
+// means copies[0] is complete (copies[1] may be mid-update).
+static TelemetrySnapshot copies[2];
+static std::atomic<uint32_t> store_sequence(0);
+static uint32_t records_written = 0;
+
+// --- Public Function Implementations ---
+
+void telemetryStoreWrite(TelemetrySnapshot *snapshot)
+{
+    snapshot->sequence = ++records_written;
+    snapshot->captured_us = esp_timer_get_time();
+
+    uint32_t sequence = store_sequence.load(std::memory_order_relaxed);
+
+    // The previous call's copy into copies[1] must be visible before the odd sequence steers
+    // readers to it
+    std::atomic_thread_fence(std::memory_order_release);
+    store_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    copies[0] = *snapshot;
+
+    std::atomic_thread_fence(std::memory_order_release);
+    store_sequence.store(sequence + 2, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    copies[1] = *snapshot;
+}
+
+void telemetryStoreRead(TelemetrySnapshot *snapshot)
+{
+    uint32_t sequence;
+    do
+    {
+        sequence = store_sequence.load(std::memory_order_acquire);
+        *snapshot = copies[sequence & 1];
+        std::atomic_thread_fence(std::memory_order_acquire); // The copy completes before the re-check
+    } while (store_sequence.load(std::memory_order_relaxed) != sequence);
+}
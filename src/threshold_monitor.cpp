@@ -0,0 +1,104 @@
+// FILE: threshold_monitor.cpp
+
+#include "threshold_monitor.h"
+#include "hal_srne.h"
+
+// --- Module-level (static) variables ---
+static ThresholdRule rules[] = {
+    {"over-voltage", ThresholdSignal::BATTERY_VOLTAGE,     OVER_VOLTAGE_TRIP_V, OVER_VOLTAGE_RELEASE_V, 0.0f,                     false, 0},
+    {"over-temp",    ThresholdSignal::BATTERY_TEMPERATURE, OVER_TEMP_TRIP_C,    OVER_TEMP_RELEASE_C,    THERMAL_DERATE_CURRENT_A, false, 0},
+};
+static const uint8_t RULE_COUNT = sizeof(rules) / sizeof(rules[0]);
+static bool apply_pending = false; // Cap changed but not yet written; retried on every sample
+static portMUX_TYPE limits_mux = portMUX_INITIALIZER_UNLOCKED; // Trip and release levels change together
+
+// --- Private Function Prototypes ---
+static float signalValue(ThresholdSignal signal, const TelemetrySnapshot &telemetry);
+
+// --- Public Function Implementations ---
+
+void thresholdMonitorEvaluate(const TelemetrySnapshot &telemetry)
+{
+    bool changed = false;
+
+    for (uint8_t i = 0; i < RULE_COUNT; i++)
+    {
+        ThresholdRule &rule = rules[i];
+        float value = signalValue(rule.signal, telemetry);
+
+        portENTER_CRITICAL(&limits_mux);
+        float trip_level = rule.trip_level;
+        float release_level = rule.release_level;
+        portEXIT_CRITICAL(&limits_mux);
+
+        if (!rule.tripped && value >= trip_level)
+        {
+            rule.tripped = true;
+            rule.trip_count++;
+            changed = true;
+            Serial.printf("🚨 %s tripped at %.2f (limit %.2f). Capping charge current to %.2fA.\n", rule.name, value, trip_level, rule.charge_current_limit);
+        }
+        else if (rule.tripped && value < release_level)
+        {
+            rule.tripped = false;
+            changed = true;
+            Serial.printf("✅ %s released at %.2f (re-arm below %.2f).\n", rule.name, value, release_level);
+        }
+    }
+
+    // A change while the controller is not yet integrated stays pending until it is
+    if (changed) apply_pending = true;
+    if (apply_pending && integrated && applyChargeCurrent() == ESP_OK)
+    {
+        apply_pending = false;
+    }
+}
+
+esp_err_t thresholdSetLimits(ThresholdSignal signal, float trip_level, float release_level)
+{
+    if (release_level > trip_level) return ESP_ERR_INVALID_ARG;
+
+    for (uint8_t i = 0; i < RULE_COUNT; i++)
+    {
+        if (rules[i].signal == signal)
+        {
+            portENTER_CRITICAL(&limits_mux);
+            rules[i].trip_level = trip_level;
+            rules[i].release_level = release_level;
+            portEXIT_CRITICAL(&limits_mux);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t applyChargeCurrent()
+{
+    float current = charge_profile.max_charge_current;
+    for (uint8_t i = 0; i < RULE_COUNT; i++)
+    {
+        if (rules[i].tripped && rules[i].charge_current_limit < current)
+        {
+            current = rules[i].charge_current_limit;
+        }
+    }
+    return limitMaxChargeCurrent(current);
+}
+
+const ThresholdRule *thresholdRules(uint8_t *count)
+{
+    *count = RULE_COUNT;
+    return rules;
+}
+
+// --- Private Function Implementations ---
+
+static float signalValue(ThresholdSignal signal, const TelemetrySnapshot &telemetry)
+{
+    switch (signal)
+    {
+        case ThresholdSignal::BATTERY_VOLTAGE:     return telemetry.battery.battery_voltage;
+        case ThresholdSignal::BATTERY_TEMPERATURE: return telemetry.battery.battery_temperature;
+    }
+    return 0.0f;
+}
@@ -7,52 +7,33 @@ void slot_1_update_data()
     esp_task_wdt_reset();
     static bool profile_updated_today = false;
     static uint8_t last_day_checked = 0;
+    static bool last_read_ok = true;
 
-    Serial.println("========== Slot 1: Data Acquisition & Profile Setup ==========");
+    // Start from the current record so fields this cycle does not read carry over
+    TelemetrySnapshot telemetry;
+    telemetryStoreRead(&telemetry);
+    batteryDataPack &battery_data = telemetry.battery;
+    solarDataPack &solar_data = telemetry.solar;
+    loadDataPack &load_data = telemetry.load;
+    timeDataPack &time_data = telemetry.time;
 
     getCurrentTime(&time_data);
 
-    Serial.println("Current Time:");
-    Serial.printf("  %02d/%02d/%04d %02d:%02d:%02d\n",
-                  time_data.day, time_data.month, time_data.year,
-                  time_data.hour, time_data.minute, time_data.second);
-    Serial.println("------------------------------------------------------------");
-
-    if (getLoadInfo(&load_data) == ESP_OK && getLoadWh(&load_data) == ESP_OK)
-    {
-        Serial.println("Load Data:");
-        Serial.printf("  Voltage                : %.2f V\n", load_data.load_voltage);
-        Serial.printf("  Current                : %.2f A\n", load_data.load_current);
-        Serial.printf("  Power                  : %d W\n", load_data.load_power);
-        Serial.println("------------------------------------------------------------");
-    }
-
-    if (getSolarInfo(&solar_data) == ESP_OK)
+    if (getRealtimeInfo(&battery_data, &solar_data, &load_data) == ESP_OK)
     {
-        Serial.println("------------------------------------------------------------");
-        Serial.println("Solar Data:");
-        Serial.printf("  Voltage                : %.2f V\n", solar_data.solar_voltage);
-        Serial.printf("  Current                : %.2f A\n", solar_data.solar_current);
-        Serial.printf("  Power                  : %d W\n", solar_data.solar_power);
-        Serial.println("------------------------------------------------------------");
+        // Replays and batches publish the totals of this sample, not the ones current at send time
+        telemetry.energy = {New_Wh, New_Wh_E, Full_Wh, Full_Wh_E, current_energy, current_energy_E};
+        telemetryStoreWrite(&telemetry);
+        thresholdMonitorEvaluate(telemetry); // Protective writes go out before anything else
+        submitTelemetrySnapshot(telemetry);
+        if (!last_read_ok) Serial.println("✅ SRNE real-time data available.");
+        last_read_ok = true;
     }
-
-    // --- แก้ไขเงื่อนไขและเพิ่มการแสดงผล ---
-    if (getBatteryInfo(&battery_data) == ESP_OK && getChargeWh(&battery_data) == ESP_OK && updateEstimatedSOC(&battery_data) == ESP_OK && get_energy(&battery_data) == ESP_OK)
+    else if (last_read_ok)
     {
-        Serial.println("------------------------------------------------------------");
-        Serial.println("Battery Data:");
-        Serial.printf("  Voltage                : %.2f V\n", battery_data.battery_voltage);
-        Serial.printf("  Current                : %.2f A\n", battery_data.battery_current);
-        Serial.printf("  SOC (From Controller)  : %d %%\n", battery_data.battery_soc);
-        Serial.printf("  SOC (Estimated)        : %.1f %%\n", battery_data.battery_soc_estimated);
-        Serial.printf("  Temp                   : %d °C\n", battery_data.battery_temperature);
-        Serial.printf("  Total Charge (Wh)      : %lu Wh\n", battery_data.charge_wh); // Address 0x011C
-        // +++ START: เพิ่มการแสดงผลค่าใหม่ +++
-        Serial.printf("  Total Charge (Ah)      : %lu Ah\n", battery_data.total_charge_ah); // Address 0x0118
-        Serial.printf("  Total Discharge (Ah)   : %lu Ah\n", battery_data.total_discharge_ah); // Address 0x011A
-        // +++ END: เพิ่มการแสดงผลค่าใหม่ +++
-        Serial.println("-----------------------------------------------------------");
+        // Reported once per outage rather than on every acquisition cycle
+        Serial.println("❌ Failed to read SRNE real-time data.");
+        last_read_ok = false;
     }
 
     // --- Handle Profile Update Logic ---
@@ -66,7 +47,7 @@ void slot_1_update_data()
     {
         setChargingProfile(time_data, &charge_profile);
         if (integrated) {
-            setMaxChargeCurrent(charge_profile.max_charge_current);
+            applyChargeCurrent();
         }
         profile_updated_today = true;
     }
@@ -75,27 +56,20 @@ void slot_1_update_data()
 void slot_2_safety_checks()
 {
     esp_task_wdt_reset();
-    static bool soc_max_reached = false;
     static bool soc_min_reached = false; // Currently unused logic
     static bool check_11_done = false;
     static bool check_12_done = false;
 
-    Serial.println("========== Slot 2: Real-time Safety & SOC Checks =============");
+    TelemetrySnapshot telemetry;
+    telemetryStoreRead(&telemetry);
+    if (telemetry.sequence == 0) return; // Nothing acquired yet
+    const batteryDataPack &battery_data = telemetry.battery;
+    const timeDataPack &time_data = telemetry.time;
 
     bool is_day_time = (time_data.hour >= 6 && time_data.hour <= 17);
     float last_max_charge_current = charge_profile.max_charge_current;
 
-    // Safety: If SOC is full during the day, stop charging
-    if ( is_day_time && battery_data.battery_voltage >= 13.9 && !soc_max_reached && integrated)//is_day_time && battery_data.battery_voltage >= 13.9 && !soc_max_reached && integrated
-    {
-        if (setMaxChargeCurrent(0.0) == ESP_OK) {
-            soc_max_reached = true;
-            Serial.println("SOC Max reached. Charging stopped.");
-        }
-    }
-    else if (!is_day_time && soc_max_reached) {
-        soc_max_reached = false; // Reset for the next day
-    }
+    // The full-battery charge cutoff lives in the threshold monitor and runs on every sample
 
     // Mid-day SOC check to boost charging if needed
     bool is_rainy_season = (charge_profile.profile_number == 2);
@@ -122,7 +96,7 @@ void slot_2_safety_checks()
     // Apply any current changes from the mid-day check
     if (is_day_time && abs(charge_profile.max_charge_current - last_max_charge_current) > 0.01 && integrated)
     {
-        setMaxChargeCurrent(charge_profile.max_charge_current);
+        applyChargeCurrent();
         Serial.printf("Mid-day SOC boost. Set charge current to %.2fA\n", charge_profile.max_charge_current);
     }
 }
@@ -133,25 +107,33 @@ void slot_3_forecasting_and_adjustment()
     static bool charge_wh_captured = false;
     static bool load_wh_captured = false;
     static bool first_forecast_run = true;
-    static bool overheated_mode = false;
-    static float current_before_overheat = 0;
+    static uint32_t last_charge_wh = 0;
+    static uint32_t last_load_wh = 0;
 
     Serial.println("========== Slot 3: Forecasting & Thermal Management ==========");
 
+    TelemetrySnapshot telemetry;
+    telemetryStoreRead(&telemetry);
+    if (telemetry.sequence == 0) return; // Nothing acquired yet
+    batteryDataPack battery_data = telemetry.battery;
+    loadDataPack load_data = telemetry.load;
+    const timeDataPack &time_data = telemetry.time;
+    battery_data.last_charge_wh = last_charge_wh;
+    load_data.last_load_wh = last_load_wh;
+
     bool is_night = (time_data.hour >= 20 || time_data.hour < 6);
     bool is_day = !is_night;
 
+    // charge_wh and load_wh come from the totals block read with every sample
     if (is_night && load_data.load_current > 0.1 && !charge_wh_captured)
     {
-        getChargeWh(&battery_data);
-        battery_data.last_charge_wh = battery_data.charge_wh;
+        last_charge_wh = battery_data.last_charge_wh = battery_data.charge_wh;
         charge_wh_captured = true;
     }
 
     if (is_day && load_data.load_current < 0.1 && charge_wh_captured && !load_wh_captured)
     {
-        getLoadWh(&load_data);
-        load_data.last_load_wh = load_data.load_wh;
+        last_load_wh = load_data.last_load_wh = load_data.load_wh;
         load_wh_captured = true;
     }
 
@@ -163,7 +145,7 @@ void slot_3_forecasting_and_adjustment()
             float forecasted_charge_wh = exponentialSmoothingWithTrend(battery_data.charge_wh);
             chargingProfileAdjustment(forecasted_charge_wh, &charge_profile, battery_data, load_data);
             if (integrated) {
-                setMaxChargeCurrent(charge_profile.max_charge_current);
+                applyChargeCurrent();
             }
         }
         clearAccumulateData();
@@ -171,23 +153,7 @@ void slot_3_forecasting_and_adjustment()
         load_wh_captured = false;
     }
 
-    bool is_peak_temp_time = (time_data.hour >= 12 && time_data.hour <= 15);
-    bool is_soc_high = (battery_data.battery_soc >= (charge_profile.max_soc - 15));
-    if (is_peak_temp_time && is_soc_high && battery_data.battery_temperature >= 65 && !overheated_mode && integrated)
-    {
-        overheated_mode = true;
-        current_before_overheat = charge_profile.max_charge_current;
-        if (setMaxChargeCurrent(2.5) == ESP_OK) {
-             Serial.println("🌡️ Overheat protection triggered. Reducing charge current.");
-        }
-    }
-    else if (is_day && overheated_mode && battery_data.battery_temperature < 60 && integrated)
-    {
-        overheated_mode = false;
-        if (setMaxChargeCurrent(current_before_overheat) == ESP_OK) {
-            Serial.println("🌡️ Temperature normal. Restoring charge current.");
-        }
-    }
+    // Thermal derating lives in the threshold monitor and runs on every sample
 }
 
 void slot_4_integration_check()
@@ -196,6 +162,13 @@ void slot_4_integration_check()
     static bool soc_recharged = false;
     Serial.println("========== Slot 4: System Integration Check ==================");
 
+    TelemetrySnapshot telemetry;
+    telemetryStoreRead(&telemetry);
+    if (telemetry.sequence == 0) return; // Nothing acquired yet
+    const batteryDataPack &battery_data = telemetry.battery;
+    const loadDataPack &load_data = telemetry.load;
+    const timeDataPack &time_data = telemetry.time;
+
     if (!integrated) {
         bool is_day_time = (time_data.hour >= 6 && time_data.hour <= 17);
         bool is_off_time = (time_data.hour >= 5 && time_data.hour <= 7);
@@ -212,20 +185,6 @@ void slot_4_integration_check()
     }
 }
 
-void slot_5_publish_data()
-{
-    esp_task_wdt_reset();
-    Serial.println("========== Slot 5: Publishing Data ===========================");
-    const char *publish_topic = "test/data/up1";
-
-    if (publishData(load_data, solar_data, battery_data, time_data, publish_topic) == ESP_OK)
-    {
-        Serial.println("✅ MQTT Publish Successful");
-    } else {
-        Serial.println("❌ MQTT Publish Failed");
-    }
-}
-
 // void slot_6_Load_Control()
 // {
 //     esp_task_wdt_reset();
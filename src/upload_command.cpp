@@ -12,23 +12,45 @@ static void checkSum(const uint8_t *data, size_t length, uint8_t &sum)
     }
 }
 
+// A 16-bit threshold level as two NVS bytes: <prefix>h<signal> and <prefix>l<signal>
+static void saveThresholdLevel(const char *prefix, uint8_t signal, uint16_t level)
+{
+    char high_key[8], high_backup[12], low_key[8], low_backup[12];
+    snprintf(high_key, sizeof(high_key), "%sh%u", prefix, signal);
+    snprintf(high_backup, sizeof(high_backup), "%sh%u_bu", prefix, signal);
+    snprintf(low_key, sizeof(low_key), "%sl%u", prefix, signal);
+    snprintf(low_backup, sizeof(low_backup), "%sl%u_bu", prefix, signal);
+    saveIntToNVS(high_key, high_backup, level >> 8);
+    saveIntToNVS(low_key, low_backup, level & 0xFF);
+}
+
 void resetListenerTask(void *parameter)
 {
     const uint8_t START_BYTE = 0xA5;
     const uint8_t END_BYTE = 0x5A;
     const uint8_t MODE_CMD = 0x04;
+    const uint16_t POLL_INTERVAL_MS = 200; // Commands are operator-paced, so a slow poll costs nothing
     
     enum Command : uint8_t {
         CMD_SET_TIME = 0x01,
         CMD_CLEAR_NVS = 0x02,
         CMD_FACTORY_RESET = 0x03,
+        CMD_PRINT_TIMING = 0x05,
+        CMD_SET_PUBLISH_PERIOD = 0x06,
+        CMD_PRINT_PROFILE = 0x08,
+        CMD_PRINT_BOOT_TRACE = 0x09,
+        CMD_SET_WIRE_FORMAT = 0x0A,
+        CMD_SET_BATCH = 0x0B,
+        CMD_SET_REPORTING = 0x0C,
+        CMD_SET_DEADBAND = 0x0D,
+        CMD_SET_THRESHOLD = 0x0E,
     };
 
     for (;;)
     {
         if (serial_port.available() < 3)
         {
-            vTaskDelay(pdMS_TO_TICKS(20));
+            vTaskDelay(pdMS_TO_TICKS(POLL_INTERVAL_MS));
             continue;
         }
 
@@ -76,6 +98,154 @@ void resetListenerTask(void *parameter)
             Serial.println("🔄 Restarting to apply time changes...");
             esp_restart();
         }
+        else if (cmd == CMD_PRINT_TIMING)
+        {
+            uint8_t payload[3]; // data + checksum + end byte
+            if (serial_port.readBytes(payload, 3) != 3) continue;
+
+            if (payload[0] != 0x01 || payload[2] != END_BYTE || (mode ^ cmd ^ payload[0]) != payload[1]) {
+                Serial.println("❌ Bad framing or checksum in TIMING packet");
+                continue;
+            }
+
+            schedulerPrint();
+            publishTimingPrint();
+        }
+        else if (cmd == CMD_PRINT_PROFILE)
+        {
+            uint8_t payload[3]; // data + checksum + end byte
+            if (serial_port.readBytes(payload, 3) != 3) continue;
+
+            if (payload[0] != 0x01 || payload[2] != END_BYTE || (mode ^ cmd ^ payload[0]) != payload[1]) {
+                Serial.println("❌ Bad framing or checksum in PROFILE packet");
+                continue;
+            }
+
+            runtimeProfileSample(); // Fresh figures; the CPU window runs from the previous sample
+            runtimeProfilePrint();
+        }
+        else if (cmd == CMD_PRINT_BOOT_TRACE)
+        {
+            uint8_t payload[3]; // data + checksum + end byte
+            if (serial_port.readBytes(payload, 3) != 3) continue;
+
+            if (payload[0] != 0x01 || payload[2] != END_BYTE || (mode ^ cmd ^ payload[0]) != payload[1]) {
+                Serial.println("❌ Bad framing or checksum in BOOT TRACE packet");
+                continue;
+            }
+
+            bootTracePrint();
+        }
+        else if (cmd == CMD_SET_WIRE_FORMAT)
+        {
+            uint8_t payload[3]; // 0 = JSON, 1 = MessagePack, 2 = binary + checksum + end byte
+            if (serial_port.readBytes(payload, 3) != 3) continue;
+
+            if (payload[0] >= WIRE_FORMAT_COUNT || payload[2] != END_BYTE || (mode ^ cmd ^ payload[0]) != payload[1]) {
+                Serial.println("❌ Bad framing or checksum in WIRE FORMAT packet");
+                continue;
+            }
+
+            saveIntToNVS("wfm", "wfm_bu", payload[0]);
+            setWireFormat((WireFormat)payload[0]);
+            Serial.printf("📤 Wire format set to %d\n", payload[0]);
+        }
+        else if (cmd == CMD_SET_BATCH)
+        {
+            uint8_t payload[5]; // max samples (0/1 = off), max age s, flags (bit 0 = flush on alarm) + checksum + end byte
+            if (serial_port.readBytes(payload, 5) != 5) continue;
+
+            if (payload[0] > TELEMETRY_BATCH_MAX_SAMPLES || payload[1] == 0 || payload[4] != END_BYTE ||
+                (mode ^ cmd ^ payload[0] ^ payload[1] ^ payload[2]) != payload[3]) {
+                Serial.println("❌ Bad framing or checksum in BATCH packet");
+                continue;
+            }
+
+            saveIntToNVS("bsz", "bsz_bu", payload[0]);
+            saveIntToNVS("bag", "bag_bu", payload[1]);
+            saveIntToNVS("bal", "bal_bu", payload[2] & 0x01);
+            BatchPolicy policy = {payload[0], payload[1], (payload[2] & 0x01) != 0};
+            setBatchPolicy(policy);
+            Serial.printf("📤 Batching: %d samples, %d s max age, flush on alarm %s\n", payload[0], payload[1], (payload[2] & 0x01) ? "on" : "off");
+        }
+        else if (cmd == CMD_SET_REPORTING)
+        {
+            uint8_t payload[3]; // keyframe interval in minutes (0 = report every field) + checksum + end byte
+            if (serial_port.readBytes(payload, 3) != 3) continue;
+
+            if (payload[2] != END_BYTE || (mode ^ cmd ^ payload[0]) != payload[1]) {
+                Serial.println("❌ Bad framing or checksum in REPORTING packet");
+                continue;
+            }
+
+            saveIntToNVS("rbe", "rbe_bu", payload[0]);
+            setReportByException(payload[0]);
+            if (payload[0] == 0) Serial.println("📤 Report by exception off");
+            else Serial.printf("📤 Report by exception on, keyframe every %d min\n", payload[0]);
+        }
+        else if (cmd == CMD_SET_DEADBAND)
+        {
+            uint8_t payload[5]; // field index, absolute steps, relative % + checksum + end byte
+            if (serial_port.readBytes(payload, 5) != 5) continue;
+
+            if (payload[4] != END_BYTE || (mode ^ cmd ^ payload[0] ^ payload[1] ^ payload[2]) != payload[3]) {
+                Serial.println("❌ Bad framing or checksum in DEADBAND packet");
+                continue;
+            }
+            if (setDeadband(payload[0], payload[1], payload[2]) != ESP_OK) {
+                Serial.println("❌ Unknown field or relative deadband over 100%");
+                continue;
+            }
+
+            char abs_key[8], abs_backup[12], rel_key[8], rel_backup[12];
+            snprintf(abs_key, sizeof(abs_key), "da%u", payload[0]);
+            snprintf(abs_backup, sizeof(abs_backup), "da%u_bu", payload[0]);
+            snprintf(rel_key, sizeof(rel_key), "dr%u", payload[0]);
+            snprintf(rel_backup, sizeof(rel_backup), "dr%u_bu", payload[0]);
+            saveIntToNVS(abs_key, abs_backup, payload[1]);
+            saveIntToNVS(rel_key, rel_backup, payload[2]);
+            saveIntToNVS("dbs", "dbs_bu", 1); // Tells boot there are deadbands to restore
+
+            uint8_t count;
+            const DeadbandField &field = deadbandFields(&count)[payload[0]];
+            Serial.printf("📤 Deadband %s: %.2f or %d%%\n", field.key, field.absolute * field.resolution, field.relative_pct);
+        }
+        else if (cmd == CMD_SET_THRESHOLD)
+        {
+            uint8_t payload[7]; // signal (0 = battery V, 1 = battery °C), trip, release (hundredths, big-endian) + checksum + end byte
+            if (serial_port.readBytes(payload, 7) != 7) continue;
+
+            if (payload[6] != END_BYTE || (mode ^ cmd ^ payload[0] ^ payload[1] ^ payload[2] ^ payload[3] ^ payload[4]) != payload[5]) {
+                Serial.println("❌ Bad framing or checksum in THRESHOLD packet");
+                continue;
+            }
+            uint16_t trip = (payload[1] << 8) | payload[2];
+            uint16_t release = (payload[3] << 8) | payload[4];
+            if (payload[0] >= THRESHOLD_SIGNAL_COUNT ||
+                thresholdSetLimits((ThresholdSignal)payload[0], trip / 100.0f, release / 100.0f) != ESP_OK) {
+                Serial.println("❌ Unknown signal or release level above the trip level");
+                continue;
+            }
+
+            saveThresholdLevel("tt", payload[0], trip);
+            saveThresholdLevel("tr", payload[0], release);
+            saveIntToNVS("ths", "ths_bu", 1); // Tells boot there are thresholds to restore
+            Serial.printf("🛡️ Threshold %d: trip at %.2f, re-arm below %.2f\n", payload[0], trip / 100.0f, release / 100.0f);
+        }
+        else if (cmd == CMD_SET_PUBLISH_PERIOD)
+        {
+            uint8_t payload[3]; // period in seconds + checksum + end byte
+            if (serial_port.readBytes(payload, 3) != 3) continue;
+
+            if (payload[0] == 0 || payload[2] != END_BYTE || (mode ^ cmd ^ payload[0]) != payload[1]) {
+                Serial.println("❌ Bad framing or checksum in PUBLISH PERIOD packet");
+                continue;
+            }
+
+            saveIntToNVS("pub", "pub_bu", payload[0]);
+            setPublishPeriod(payload[0] * 1000UL);
+            Serial.printf("📤 Publish period set to %d s\n", payload[0]);
+        }
         else if (cmd == CMD_CLEAR_NVS || cmd == CMD_FACTORY_RESET)
         {
             uint8_t payload[3]; // data + checksum + end byte
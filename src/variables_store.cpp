@@ -2,43 +2,6 @@
 
 #include "config.h"
 
-batteryDataPack battery_data = {
-    .battery_voltage = 0.0,
-    .battery_current = 0.0,
-    .battery_soc = 0,
-    .battery_temperature = 0,
-    .charge_wh = 0,
-    .last_charge_wh = 0,
-    .battery_soc_estimated = 0.0,
-    // +++ START: เพิ่มค่าเริ่มต้นให้ตัวแปรใหม่ +++
-    .total_charge_ah = 0,
-    .total_discharge_ah = 0,
-    // +++ END: เพิ่มค่าเริ่มต้นให้ตัวแปรใหม่ +++
-};
-
-solarDataPack solar_data = {
-    .solar_voltage = 0.0,
-    .solar_current = 0.0,
-    .solar_power = 0,
-};
-
-loadDataPack load_data = {
-    .load_voltage = 0.0,
-    .load_current = 0.0,
-    .load_power = 0,
-    .load_wh = 0,
-    .last_load_wh = 0,
-};
-
-timeDataPack time_data = {
-    .day = 0,
-    .month = 0,
-    .year = 0,
-    .hour = 0,
-    .minute = 0,
-    .second = 0,
-};
-
 chargingProfilePack charge_profile = {
     .profile_number = 0,
     .max_charge_current = 0.0,
@@ -89,8 +52,6 @@ int loaded_tud = 0;
 int loaded_pgr = 0;
 bool integrated = true;
 volatile bool upload_mode = false;
-volatile bool taskDone = true;
-volatile uint8_t s = 0;
 volatile int TimeStartNewCurrent = 0;
 volatile bool NewCurrent = false;
 
@@ -0,0 +1,285 @@
+// FILE: crc_bench.cpp
+//
+// Host-side check and benchmark for the table-driven CRC engines in src/crc_utils.cpp. Each is
+// compared bit for bit with the bitwise loop it replaced (calculateCRC16 from hal_srne.cpp and
+// crc32 from nvs_utils.cpp) over random buffers, both in one call and fed in random chunks
+// through the *Update() functions, and then both versions are timed.
+//
+// Build:  g++ -O2 -std=gnu++11 -Iinclude -o crc_bench tools/crc_bench/crc_bench.cpp src/crc_utils.cpp
+// Run:    ./crc_bench --buffers 20000 --max-length 300 --seed 1
+//
+// Exits with status 1 on the first mismatch, printing the buffer that caused it.
+
+#include "crc_utils.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// --- Configuration ---
+struct BenchConfig
+{
+    uint32_t buffers;    // Random buffers compared
+    uint32_t max_length; // Buffer lengths are 0..max_length bytes
+    uint32_t seed;
+    double min_seconds;  // Each timing runs at least this long
+};
+
+static BenchConfig config = {20000, 300, 0, 0.2};
+
+// --- Module-level (static) variables ---
+static const size_t BULK_LENGTH = 64 * 1024;
+static volatile uint32_t sink; // Keeps the timed results alive
+
+// --- Private Function Prototypes ---
+static void usage(const char *name);
+static bool parseArgs(int argc, char **argv);
+static uint32_t nextRandom();
+static double nowSeconds();
+static uint16_t referenceCrc16(const uint8_t *data, size_t length);
+static uint32_t referenceCrc32(const uint8_t *data, size_t length);
+static bool compareBuffer(const uint8_t *data, size_t length);
+static void dumpBuffer(const uint8_t *data, size_t length);
+static double timeNs(uint32_t (*crc)(const uint8_t *, size_t), const uint8_t *data, size_t length);
+static uint32_t tableCrc16(const uint8_t *data, size_t length);
+static uint32_t bitwiseCrc16(const uint8_t *data, size_t length);
+static uint32_t tableCrc32(const uint8_t *data, size_t length);
+static uint32_t bitwiseCrc32(const uint8_t *data, size_t length);
+
+// --- Main ---
+
+int main(int argc, char **argv)
+{
+    if (!parseArgs(argc, argv))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (config.seed == 0) config.seed = (uint32_t)time(NULL);
+
+    // Known answers for "123456789"
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    if (crc16Modbus(check, sizeof(check)) != 0x4B37 || crc32(check, sizeof(check)) != 0xCBF43926UL)
+    {
+        printf("FAIL: check value (CRC-16 %04X, CRC-32 %08X)\n", crc16Modbus(check, sizeof(check)),
+               crc32(check, sizeof(check)));
+        return 1;
+    }
+
+    printf("Comparing %u random buffers of 0-%u bytes (seed %u)\n", config.buffers, config.max_length, config.seed);
+    uint8_t *buffer = (uint8_t *)malloc(config.max_length + 1);
+    for (uint32_t n = 0; n < config.buffers; n++)
+    {
+        size_t length = nextRandom() % (config.max_length + 1);
+        for (size_t i = 0; i < length; i++) buffer[i] = (uint8_t)nextRandom();
+        if (!compareBuffer(buffer, length))
+        {
+            dumpBuffer(buffer, length);
+            free(buffer);
+            return 1;
+        }
+    }
+    free(buffer);
+    printf("PASS: CRC-16/MODBUS and CRC-32 match the bitwise versions\n\n");
+
+    // Modbus frames as the HAL sends them (request, 8-register read reply), then bulk throughput
+    uint8_t *bulk = (uint8_t *)malloc(BULK_LENGTH);
+    for (size_t i = 0; i < BULK_LENGTH; i++) bulk[i] = (uint8_t)nextRandom();
+
+    const size_t lengths[] = {6, 19, BULK_LENGTH};
+    printf("%-10s %8s %12s %12s %8s\n", "CRC", "bytes", "bitwise ns", "table ns", "speedup");
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+    {
+        double bitwise = timeNs(bitwiseCrc16, bulk, lengths[i]);
+        double table = timeNs(tableCrc16, bulk, lengths[i]);
+        printf("%-10s %8zu %12.1f %12.1f %7.1fx\n", "CRC-16", lengths[i], bitwise, table, bitwise / table);
+    }
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+    {
+        double bitwise = timeNs(bitwiseCrc32, bulk, lengths[i]);
+        double table = timeNs(tableCrc32, bulk, lengths[i]);
+        printf("%-10s %8zu %12.1f %12.1f %7.1fx\n", "CRC-32", lengths[i], bitwise, table, bitwise / table);
+    }
+
+    double bitwise = timeNs(bitwiseCrc16, bulk, BULK_LENGTH);
+    double table = timeNs(tableCrc16, bulk, BULK_LENGTH);
+    printf("\nCRC-16 throughput: bitwise %.0f MB/s, table %.0f MB/s\n", BULK_LENGTH / bitwise * 1000.0,
+           BULK_LENGTH / table * 1000.0);
+    bitwise = timeNs(bitwiseCrc32, bulk, BULK_LENGTH);
+    table = timeNs(tableCrc32, bulk, BULK_LENGTH);
+    printf("CRC-32 throughput: bitwise %.0f MB/s, table %.0f MB/s\n", BULK_LENGTH / bitwise * 1000.0,
+           BULK_LENGTH / table * 1000.0);
+
+    free(bulk);
+    return 0;
+}
+
+// --- Private Function Implementations ---
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [options]\n"
+           "  --buffers N      random buffers to compare (default %u)\n"
+           "  --max-length N   longest buffer in bytes (default %u)\n"
+           "  --seed N         random seed, 0 = time (default 0)\n"
+           "  --min-time S     seconds per timing (default %.1f)\n",
+           name, config.buffers, config.max_length, config.min_seconds);
+}
+
+static bool parseArgs(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--buffers") == 0 && value)
+        {
+            config.buffers = (uint32_t)strtoul(value, NULL, 0);
+            i++;
+        }
+        else if (strcmp(arg, "--max-length") == 0 && value)
+        {
+            config.max_length = (uint32_t)strtoul(value, NULL, 0);
+            i++;
+        }
+        else if (strcmp(arg, "--seed") == 0 && value)
+        {
+            config.seed = (uint32_t)strtoul(value, NULL, 0);
+            i++;
+        }
+        else if (strcmp(arg, "--min-time") == 0 && value)
+        {
+            config.min_seconds = atof(value);
+            i++;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return config.min_seconds > 0;
+}
+
+// xorshift32: repeatable for a given seed on every host, unlike rand()
+static uint32_t nextRandom()
+{
+    config.seed ^= config.seed << 13;
+    config.seed ^= config.seed >> 17;
+    config.seed ^= config.seed << 5;
+    return config.seed;
+}
+
+static double nowSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// calculateCRC16() as it was in hal_srne.cpp
+static uint16_t referenceCrc16(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; ++i)
+    {
+        crc ^= data[i];
+        for (size_t j = 0; j < 8; ++j)
+        {
+            if (crc & 0x0001)
+            {
+                crc = (crc >> 1) ^ 0xA001;
+            }
+            else
+            {
+                crc >>= 1;
+            }
+        }
+    }
+    return crc;
+}
+
+// crc32() as it was in nvs_utils.cpp
+static uint32_t referenceCrc32(const uint8_t *data, size_t length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    while (length--)
+    {
+        crc ^= *data++;
+        for (uint8_t i = 0; i < 8; i++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (-(int)(crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+// One-shot, then the same buffer in up to four random chunks
+static bool compareBuffer(const uint8_t *data, size_t length)
+{
+    uint16_t expected16 = referenceCrc16(data, length);
+    uint32_t expected32 = referenceCrc32(data, length);
+
+    uint16_t got16 = crc16Modbus(data, length);
+    uint32_t got32 = crc32(data, length);
+    if (got16 != expected16 || got32 != expected32)
+    {
+        printf("FAIL: %zu bytes one-shot: CRC-16 %04X expected %04X, CRC-32 %08X expected %08X\n",
+               length, got16, expected16, got32, expected32);
+        return false;
+    }
+
+    uint8_t chunks = 1 + nextRandom() % 4;
+    size_t offset = 0;
+    got16 = CRC16_MODBUS_INIT;
+    got32 = 0;
+    for (uint8_t c = 0; c < chunks; c++)
+    {
+        size_t remaining = length - offset;
+        size_t chunk = (c == chunks - 1 || remaining == 0) ? remaining : nextRandom() % (remaining + 1);
+        got16 = crc16ModbusUpdate(got16, data + offset, chunk);
+        got32 = crc32Update(got32, data + offset, chunk);
+        offset += chunk;
+    }
+    if (got16 != expected16 || got32 != expected32)
+    {
+        printf("FAIL: %zu bytes in %u chunks: CRC-16 %04X expected %04X, CRC-32 %08X expected %08X\n",
+               length, chunks, got16, expected16, got32, expected32);
+        return false;
+    }
+    return true;
+}
+
+static void dumpBuffer(const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        printf("%02X%s", data[i], (i % 32 == 31 || i == length - 1) ? "\n" : " ");
+    }
+}
+
+// Average time of one call, repeated until config.min_seconds has passed
+static double timeNs(uint32_t (*crc)(const uint8_t *, size_t), const uint8_t *data, size_t length)
+{
+    uint64_t calls = 0;
+    uint64_t batch = length >= 4096 ? 1 : 4096 / (length + 1);
+    double start = nowSeconds();
+    double elapsed;
+    do
+    {
+        for (uint64_t i = 0; i < batch; i++)
+        {
+            sink += crc(data, length);
+        }
+        calls += batch;
+        elapsed = nowSeconds() - start;
+    } while (elapsed < config.min_seconds);
+
+    return elapsed * 1e9 / calls;
+}
+
+static uint32_t tableCrc16(const uint8_t *data, size_t length) { return crc16Modbus(data, length); }
+static uint32_t bitwiseCrc16(const uint8_t *data, size_t length) { return referenceCrc16(data, length); }
+static uint32_t tableCrc32(const uint8_t *data, size_t length) { return crc32(data, length); }
+static uint32_t bitwiseCrc32(const uint8_t *data, size_t length) { return referenceCrc32(data, length); }
@@ -0,0 +1,365 @@
+// FILE: json_alloc_check.cpp
+//
+// Host check that the keyed messages never touch the heap. It runs the firmware's document
+// builders (src/telemetry_document.cpp, unchanged) the way the publisher does. Each document goes
+// into a JsonArenaLease. Diagnostics are built in the second arena while the telemetry or batch
+// lease is still held, as publishDiagnosticsIfDue() does. Every document is then measured and
+// serialized as JSON and as MessagePack. While a round runs, malloc, calloc and realloc are
+// counted.
+//
+// Build:  g++ -O2 -std=gnu++11 -pthread -DARDUINOJSON_SLOT_ID_SIZE=2 -DARDUINOJSON_POOL_CAPACITY=128
+//             -I.pio/libdeps/esp32dev/ArduinoJson/src -Itools/srne_sim/host -Iinclude
+//             -o json_alloc_check tools/json_alloc_check/json_alloc_check.cpp
+//             tools/srne_sim/host/host_shim.cpp src/telemetry_document.cpp src/json_arena.cpp
+//             src/telemetry_codec.cpp src/telemetry_deadband.cpp src/srne_link_stats.cpp
+//             src/exec_timing.cpp
+// Run:    ./json_alloc_check --rounds 200
+//
+// The real ArduinoJson must come before the host shim directory, whose ArduinoJson.h is empty.
+// The stats the diagnostics report come from the stand-ins below, filled to the firmware's
+// limits: every job, task, function code and published register slot is used. The exit status is
+// 1 if any allocation reached the heap, or if jsonArenaGetStats() counted a heap fallback.
+//
+// The two -D options give ArduinoJson the ESP32's slot ids and pool capacity, so a document takes
+// as many slots and pools as on the target. On a 64-bit host each slot is 16 bytes instead of 8,
+// and JSON_ARENA_SIZE doubles with it. Strings are the same size on both.
+
+#include "telemetry_document.h"
+#include "telemetry_deadband.h"
+#include "telemetry_outbox.h"
+#include "telemetry_pipeline.h"
+#include "runtime_profile.h"
+#include "scheduler.h"
+#include "srne_link_stats.h"
+#include "json_arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// glibc's allocator entry points, which the counting hooks below forward to
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+// --- Configuration ---
+struct CheckConfig
+{
+    uint32_t rounds;
+    uint8_t batch_samples;
+    uint32_t seed;
+};
+
+static CheckConfig config = {100, TELEMETRY_BATCH_MAX_SAMPLES, 1};
+
+// --- Module-level (static) variables ---
+static volatile bool counting = false;
+static volatile uint32_t heap_allocations = 0;
+
+static char output_buffer[16384];
+static size_t largest_json[3];    // Telemetry, batch, diagnostics
+static size_t largest_msgpack[3];
+static const char *DOCUMENT_NAMES[3] = {"telemetry", "batch", "diagnostics"};
+
+static SchedulerJob jobs[SCHEDULER_MAX_JOBS];
+static RuntimeProfile profile;
+static TelemetrySnapshot samples[TELEMETRY_BATCH_MAX_SAMPLES];
+
+// --- Private Function Prototypes ---
+static void usage(const char *name);
+static bool parseArgs(int argc, char **argv);
+static uint32_t nextRandom();
+static float randomValue(float low, float high);
+static void fillSnapshot(TelemetrySnapshot *snapshot, uint32_t sequence);
+static void fillLinkStats();
+static void fillJobs();
+static bool serializeDocument(JsonDocument &doc, uint8_t kind);
+static bool buildDiagnostics(uint32_t round);
+static bool runRound(uint32_t round);
+
+// --- Counting allocator hooks ---
+
+extern "C" void *malloc(size_t size)
+{
+    if (counting) heap_allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    if (counting) heap_allocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    if (counting) heap_allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr)
+{
+    __libc_free(ptr);
+}
+
+// --- Firmware stand-ins ---
+
+const SchedulerJob *schedulerJobs(uint8_t *count)
+{
+    *count = SCHEDULER_MAX_JOBS;
+    return jobs;
+}
+
+void runtimeProfileGet(RuntimeProfile *copy)
+{
+    *copy = profile;
+}
+
+void outboxGetStats(OutboxStats *stats)
+{
+    stats->pending = 4294967295UL;
+    stats->flash_capacity = 4294967295UL;
+    stats->replayed = 4294967295UL;
+    stats->dropped = 4294967295UL;
+    stats->flash_errors = 4294967295UL;
+}
+
+// --- Main ---
+
+int main(int argc, char **argv)
+{
+    if (!parseArgs(argc, argv))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    fillLinkStats();
+    fillJobs();
+    setReportByException(5);
+
+    bool ok = true;
+    for (uint32_t round = 0; round < config.rounds && ok; round++)
+    {
+        ok = runRound(round);
+    }
+
+    JsonArenaStats arena;
+    jsonArenaGetStats(&arena);
+    printf("%-12s %10s %10s\n", "document", "JSON max", "MsgPack max");
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        printf("%-12s %10zu %10zu\n", DOCUMENT_NAMES[i], largest_json[i], largest_msgpack[i]);
+    }
+    printf("\nArena high water %u of %zu bytes, %u heap fallbacks, %u heap allocations\n",
+           arena.high_water_bytes, JSON_ARENA_SIZE, arena.heap_fallbacks, heap_allocations);
+
+    if (!ok || arena.heap_fallbacks != 0 || heap_allocations != 0)
+    {
+        printf("FAIL: documents reached the heap\n");
+        return 1;
+    }
+    printf("PASS: %u rounds with a %u-sample batch, no heap allocations\n", config.rounds, config.batch_samples);
+    return 0;
+}
+
+// --- Private Function Implementations ---
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [options]\n"
+           "  --rounds N       telemetry + batch + diagnostics rounds (default %u)\n"
+           "  --samples N      samples per batch, 1-%u (default %u)\n"
+           "  --seed N         random seed (default %u)\n",
+           name, config.rounds, TELEMETRY_BATCH_MAX_SAMPLES, config.batch_samples, config.seed);
+}
+
+static bool parseArgs(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--rounds") == 0 && value)
+        {
+            config.rounds = (uint32_t)strtoul(value, NULL, 0);
+            i++;
+        }
+        else if (strcmp(arg, "--samples") == 0 && value)
+        {
+            config.batch_samples = (uint8_t)strtoul(value, NULL, 0);
+            i++;
+        }
+        else if (strcmp(arg, "--seed") == 0 && value)
+        {
+            config.seed = (uint32_t)strtoul(value, NULL, 0);
+            i++;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return config.batch_samples >= 1 && config.batch_samples <= TELEMETRY_BATCH_MAX_SAMPLES && config.seed != 0;
+}
+
+// xorshift32, as in crc_bench
+static uint32_t nextRandom()
+{
+    config.seed ^= config.seed << 13;
+    config.seed ^= config.seed >> 17;
+    config.seed ^= config.seed << 5;
+    return config.seed;
+}
+
+static float randomValue(float low, float high)
+{
+    return low + (high - low) * (nextRandom() % 100000) / 100000.0f;
+}
+
+// Values with as many digits as the controller can report, so the strings are at full length
+static void fillSnapshot(TelemetrySnapshot *snapshot, uint32_t sequence)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->sequence = sequence;
+    snapshot->load.load_voltage = randomValue(10.0f, 16.0f);
+    snapshot->load.load_current = randomValue(0.0f, 20.0f);
+    snapshot->load.load_power = (int)randomValue(0.0f, 320.0f);
+    snapshot->load.load_wh = 4000000000UL + nextRandom() % 100000;
+    snapshot->solar.solar_voltage = randomValue(0.0f, 99.99f);
+    snapshot->solar.solar_current = randomValue(0.0f, 30.0f);
+    snapshot->solar.solar_power = (int)randomValue(0.0f, 1200.0f);
+    snapshot->battery.battery_voltage = randomValue(10.0f, 16.0f);
+    snapshot->battery.battery_current = randomValue(-40.0f, 40.0f);
+    snapshot->battery.battery_soc = (int)randomValue(0.0f, 100.0f);
+    snapshot->battery.battery_temperature = (int)randomValue(-40.0f, 85.0f);
+    snapshot->battery.charge_wh = 4000000000UL + nextRandom() % 100000;
+    snapshot->battery.battery_soc_estimated = randomValue(0.0f, 100.0f);
+    snapshot->battery.total_charge_ah = 4000000000UL + nextRandom() % 100000;
+    snapshot->battery.total_discharge_ah = 4000000000UL + nextRandom() % 100000;
+    snapshot->time = {28, 12, 2099, 23, 59, (uint8_t)(sequence % 60)};
+    snapshot->energy = {randomValue(-99999.0f, 99999.0f), randomValue(-99999.0f, 99999.0f),
+                        randomValue(-99999.0f, 99999.0f), randomValue(-99999.0f, 99999.0f),
+                        randomValue(-99999.0f, 99999.0f), randomValue(-99999.0f, 99999.0f)};
+}
+
+// Every function code used and failing, and more failing registers than the message publishes
+static void fillLinkStats()
+{
+    const uint8_t function_codes[SRNE_LINK_FUNCTION_COUNT] = {0x03, 0x06, 0x10};
+    for (uint8_t f = 0; f < SRNE_LINK_FUNCTION_COUNT; f++)
+    {
+        for (uint16_t r = 0; r < SRNE_LINK_REGISTER_SLOTS; r++)
+        {
+            uint16_t address = 0xE000 + r * 0x11;
+            srneLinkRecordAttempt(function_codes[f], address, ESP_OK, 1000 + r * 20000, false);
+            srneLinkRecordAttempt(function_codes[f], address, ESP_ERR_TIMEOUT, 0, true);
+            srneLinkRecordAttempt(function_codes[f], address, ESP_ERR_INVALID_CRC, 0, true);
+            srneLinkRecordAttempt(function_codes[f], address, ESP_ERR_INVALID_RESPONSE, 0, true);
+        }
+    }
+}
+
+static void fillJobs()
+{
+    static const char *names[SCHEDULER_MAX_JOBS] = {"safety", "acquire", "integrate", "forecast",
+                                                    "profile", "load", "spare_job6", "spare_job7"};
+    for (uint8_t i = 0; i < SCHEDULER_MAX_JOBS; i++)
+    {
+        jobs[i].name = names[i];
+        jobs[i].skipped = 4294967295UL;
+        jobs[i].timing.max_us = 4294967295UL;
+        jobs[i].timing.deadline_misses = 4294967295UL;
+    }
+
+    profile.task_count = PROFILE_MAX_TASKS;
+    for (uint8_t i = 0; i < PROFILE_MAX_TASKS; i++)
+    {
+        snprintf(profile.tasks[i].name, sizeof(profile.tasks[i].name), "HostTaskName%03u", i);
+        profile.tasks[i].cpu_permille = 1000;
+        profile.tasks[i].stack_free_bytes = 4294967295UL;
+    }
+    profile.heap_free_bytes = 4294967295UL;
+    profile.heap_largest_block_bytes = 4294967295UL;
+    profile.heap_min_free_bytes = 4294967295UL;
+}
+
+// What publishDocument() does with a document, into a buffer instead of the MQTT stream
+static bool serializeDocument(JsonDocument &doc, uint8_t kind)
+{
+    if (doc.overflowed())
+    {
+        printf("FAIL: %s document overflowed\n", DOCUMENT_NAMES[kind]);
+        return false;
+    }
+
+    size_t json = measureJson(doc);
+    size_t msgpack = measureMsgPack(doc);
+    if (json >= sizeof(output_buffer) || msgpack > sizeof(output_buffer))
+    {
+        printf("FAIL: %s document is %zu bytes, the check buffer %zu\n", DOCUMENT_NAMES[kind], json, sizeof(output_buffer));
+        return false;
+    }
+    if (serializeJson(doc, output_buffer, sizeof(output_buffer)) != json ||
+        serializeMsgPack(doc, output_buffer, sizeof(output_buffer)) != msgpack)
+    {
+        printf("FAIL: %s document serialized to a different length than measured\n", DOCUMENT_NAMES[kind]);
+        return false;
+    }
+
+    if (json > largest_json[kind]) largest_json[kind] = json;
+    if (msgpack > largest_msgpack[kind]) largest_msgpack[kind] = msgpack;
+    return true;
+}
+
+// publishDiagnosticsIfDue() runs while the caller's lease is still held, so this takes the other
+// arena
+static bool buildDiagnostics(uint32_t round)
+{
+    profile.sampled_ms = round + 1; // A new sample every time, so the profile is always included
+    PublishHeapStats publish_heap = {4294967295UL, 4294967295UL, 4294967295UL};
+
+    JsonArenaLease arena;
+    JsonDocument doc(arena.allocator());
+    buildDiagnosticsDocument(doc, publish_heap, round);
+    return serializeDocument(doc, 2);
+}
+
+static bool runRound(uint32_t round)
+{
+    TelemetrySnapshot snapshot;
+    fillSnapshot(&snapshot, round + 1);
+    for (uint8_t i = 0; i < config.batch_samples; i++)
+    {
+        fillSnapshot(&samples[i], round * config.batch_samples + i + 1);
+    }
+    bool replayed = round % 4 == 3;
+    uint32_t allocations_before = heap_allocations;
+
+    counting = true;
+    bool ok;
+    {
+        JsonArenaLease arena;
+        JsonDocument doc(arena.allocator());
+        bool filtered = buildTelemetryDocument(doc, snapshot, replayed);
+        ok = serializeDocument(doc, 0);
+        if (filtered) deadbandCommit(ok);
+        ok = ok && buildDiagnostics(round);
+    }
+    {
+        JsonArenaLease arena;
+        JsonDocument doc(arena.allocator());
+        buildBatchDocument(doc, samples, config.batch_samples);
+        ok = ok && serializeDocument(doc, 1);
+        ok = ok && buildDiagnostics(round);
+    }
+    counting = false;
+
+    if (heap_allocations != allocations_before)
+    {
+        printf("FAIL: round %u made %u heap allocations\n", round, heap_allocations - allocations_before);
+        return false;
+    }
+    return ok;
+}
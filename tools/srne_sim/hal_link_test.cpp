@@ -0,0 +1,174 @@
+// FILE: hal_link_test.cpp
+//
+// Runs the firmware's SRNE HAL (src/hal_srne.cpp, unchanged) on the host against srne_sim, through
+// the uart_*/FreeRTOS shim in tools/srne_sim/host. Everything between the public HAL calls and the
+// pty is the real code: the bus task and its queues, framing and CRC checks, the adaptive reply
+// timeout, retries with backoff and the link counters.
+//
+// Build:  g++ -O2 -std=gnu++11 -pthread -Itools/srne_sim/host -Iinclude -o hal_link_test
+//             tools/srne_sim/hal_link_test.cpp tools/srne_sim/host/host_shim.cpp
+//             src/hal_srne.cpp src/srne_link_stats.cpp src/crc_utils.cpp
+// Run:    ./srne_sim --link /tmp/srne --drop 5 --corrupt 5 &
+//         ./hal_link_test --link /tmp/srne --rounds 100
+//
+// Every round reads the real-time and totals blocks (FC 0x03); every tenth also changes the max
+// charge current (FC 0x06) and the manual load power (FC 0x10) and reads the settings back. The
+// exit status is 1 if any request still failed after its retries, or a written value did not
+// read back.
+
+#include "hal_srne.h"
+#include "srne_link_stats.h"
+#include "driver/uart.h"
+#include "esp_timer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- Configuration ---
+struct TestConfig
+{
+    const char *link_path;
+    uint32_t rounds;
+};
+
+static TestConfig config = {NULL, 50};
+
+// --- Module-level (static) variables ---
+static const uart_port_t SRNE_UART_PORT = UART_NUM_1; // As in hal_srne.cpp
+
+static uint32_t requests = 0;
+static uint32_t failures = 0;
+
+// --- Private Function Prototypes ---
+static void usage(const char *name);
+static bool parseArgs(int argc, char **argv);
+static void check(const char *what, esp_err_t result);
+static void printLinkStats();
+
+// --- Main ---
+
+int main(int argc, char **argv)
+{
+    if (!parseArgs(argc, argv))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (hostUartAttach(SRNE_UART_PORT, config.link_path) != ESP_OK)
+    {
+        perror(config.link_path);
+        return 1;
+    }
+    if (setupSrne(SRNE_RX_PIN, SRNE_TX_PIN) != ESP_OK) return 1;
+    check("refreshConfigShadow", refreshConfigShadow());
+
+    batteryDataPack battery = {};
+    solarDataPack solar = {};
+    loadDataPack load = {};
+    int64_t started_us = esp_timer_get_time();
+    for (uint32_t round = 0; round < config.rounds; round++)
+    {
+        check("getRealtimeInfo", getRealtimeInfo(&battery, &solar, &load));
+
+        if (round % 10 == 9)
+        {
+            float current = (round / 10) % 2 ? 3.0f : 2.0f;
+            check("setMaxChargeCurrent", setMaxChargeCurrent(current));
+            check("setManualLoadPowerWithDuration", setManualLoadPowerWithDuration(round % 100, 60));
+
+            // A fresh read must see the new value, so the setter skips its write
+            invalidateConfigShadow();
+            SrneFunctionStats functions[SRNE_LINK_FUNCTION_COUNT];
+            srneLinkStatsSnapshot(functions, NULL, 0);
+            uint32_t writes_before = functions[1].counters.attempts; // FC 0x06
+            check("refreshConfigShadow", refreshConfigShadow());
+            check("setMaxChargeCurrent again", setMaxChargeCurrent(current));
+            srneLinkStatsSnapshot(functions, NULL, 0);
+            if (functions[1].counters.attempts != writes_before)
+            {
+                printf("FAIL: max charge current %.1f A did not read back\n", current);
+                failures++;
+            }
+        }
+    }
+    double elapsed_s = (esp_timer_get_time() - started_us) / 1e6;
+
+    printf("\nBattery %.2f V %.2f A, solar %.2f V %.2f A, load %.2f V %.2f A\n",
+           battery.battery_voltage, battery.battery_current, solar.solar_voltage, solar.solar_current,
+           load.load_voltage, load.load_current);
+    printf("%u rounds in %.1f s, %u of %u requests failed after retries\n\n",
+           config.rounds, elapsed_s, failures, requests);
+    printLinkStats();
+    return failures == 0 ? 0 : 1;
+}
+
+// --- Private Function Implementations ---
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s --link PATH [options]\n"
+            "  --link PATH      srne_sim's --link path (or any tty with a controller on it)\n"
+            "  --rounds N       telemetry rounds (default %u)\n",
+            name, config.rounds);
+}
+
+static bool parseArgs(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--link") == 0 && value)
+        {
+            config.link_path = value;
+            i++;
+        }
+        else if (strcmp(arg, "--rounds") == 0 && value)
+        {
+            config.rounds = (uint32_t)strtoul(value, NULL, 0);
+            i++;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return config.link_path != NULL;
+}
+
+static void check(const char *what, esp_err_t result)
+{
+    requests++;
+    if (result == ESP_OK) return;
+
+    failures++;
+    printf("FAIL: %s: %s\n", what, esp_err_to_name(result));
+}
+
+static void printLinkStats()
+{
+    SrneFunctionStats functions[SRNE_LINK_FUNCTION_COUNT];
+    srneLinkStatsSnapshot(functions, NULL, 0);
+
+    printf("FC  %8s %8s %8s %8s %8s %8s   latency histogram (ms:", "sent", "ok", "timeout", "crc", "framing", "retries");
+    for (uint8_t b = 0; b < SRNE_LATENCY_BUCKETS - 1; b++)
+    {
+        printf(" <%u", SRNE_LATENCY_BUCKET_MS[b]);
+    }
+    printf(" more)\n");
+
+    for (uint8_t i = 0; i < SRNE_LINK_FUNCTION_COUNT; i++)
+    {
+        const SrneLinkCounters &c = functions[i].counters;
+        printf("%02X  %8u %8u %8u %8u %8u %8u  ", functions[i].function_code, c.attempts, c.successes, c.timeouts,
+               c.crc_errors, c.framing_errors, c.retries);
+        for (uint8_t b = 0; b < SRNE_LATENCY_BUCKETS; b++)
+        {
+            printf(" %u", functions[i].latency_histogram[b]);
+        }
+        printf("\n");
+    }
+}
@@ -0,0 +1,30 @@
+// FILE: Arduino.h
+//
+// Host shim: the part of the Arduino core the SRNE HAL and the message builders use. Serial goes
+// to stdout.
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+class HardwareSerial
+{
+public:
+    int printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    size_t print(const char *text);
+    size_t println(const char *text = "");
+};
+
+extern HardwareSerial Serial;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#endif // HOST_ARDUINO_H
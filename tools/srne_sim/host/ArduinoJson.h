@@ -0,0 +1,8 @@
+// FILE: ArduinoJson.h
+//
+// Host shim: included by config.h, not used by the SRNE HAL.
+
+#ifndef HOST_ARDUINOJSON_H
+#define HOST_ARDUINOJSON_H
+
+#endif // HOST_ARDUINOJSON_H
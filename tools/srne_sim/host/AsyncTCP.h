@@ -0,0 +1,8 @@
+// FILE: AsyncTCP.h
+//
+// Host shim: included by config.h, not used by the SRNE HAL.
+
+#ifndef HOST_ASYNCTCP_H
+#define HOST_ASYNCTCP_H
+
+#endif // HOST_ASYNCTCP_H
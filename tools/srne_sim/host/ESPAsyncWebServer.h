@@ -0,0 +1,8 @@
+// FILE: ESPAsyncWebServer.h
+//
+// Host shim: included by config.h, not used by the SRNE HAL.
+
+#ifndef HOST_ESPASYNCWEBSERVER_H
+#define HOST_ESPASYNCWEBSERVER_H
+
+#endif // HOST_ESPASYNCWEBSERVER_H
@@ -0,0 +1,8 @@
+// FILE: ElegantOTA.h
+//
+// Host shim: included by config.h, not used by the SRNE HAL.
+
+#ifndef HOST_ELEGANTOTA_H
+#define HOST_ELEGANTOTA_H
+
+#endif // HOST_ELEGANTOTA_H
@@ -0,0 +1,8 @@
+// FILE: Preferences.h
+//
+// Host shim: included by config.h, not used by the SRNE HAL.
+
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#endif // HOST_PREFERENCES_H
@@ -0,0 +1,8 @@
+// FILE: PubSubClient.h
+//
+// Host shim: included by config.h, not used by the SRNE HAL.
+
+#ifndef HOST_PUBSUBCLIENT_H
+#define HOST_PUBSUBCLIENT_H
+
+#endif // HOST_PUBSUBCLIENT_H
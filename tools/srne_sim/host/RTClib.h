@@ -0,0 +1,12 @@
+// FILE: RTClib.h
+//
+// Host shim: config.h declares the RTC object, the SRNE HAL never uses it.
+
+#ifndef HOST_RTCLIB_H
+#define HOST_RTCLIB_H
+
+class RTC_DS3231
+{
+};
+
+#endif // HOST_RTCLIB_H
@@ -0,0 +1,8 @@
+// FILE: WiFi.h
+//
+// Host shim: included by config.h, not used by the SRNE HAL.
+
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#endif // HOST_WIFI_H
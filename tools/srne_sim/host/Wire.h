@@ -0,0 +1,8 @@
+// FILE: Wire.h
+//
+// Host shim: included by config.h, not used by the SRNE HAL.
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#endif // HOST_WIRE_H
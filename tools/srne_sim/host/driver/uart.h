@@ -0,0 +1,74 @@
+// FILE: uart.h
+//
+// Host shim: the ESP-IDF UART driver on a tty, normally the srne_sim pty. A reader thread posts
+// the same events the driver does: UART_DATA when 120 bytes have arrived or the line has been
+// quiet for the RX timeout (timeout_flag set), UART_BUFFER_FULL when the RX buffer overflows.
+// Both directions are paced at the configured baud rate, so turnaround and reply latencies match
+// a real 9600 baud link rather than an instant pty.
+
+#ifndef HOST_DRIVER_UART_H
+#define HOST_DRIVER_UART_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef int uart_port_t;
+#define UART_NUM_0 0
+#define UART_NUM_1 1
+#define UART_NUM_2 2
+#define UART_NUM_MAX 3
+#define UART_PIN_NO_CHANGE (-1)
+
+enum uart_word_length_t { UART_DATA_5_BITS, UART_DATA_6_BITS, UART_DATA_7_BITS, UART_DATA_8_BITS };
+enum uart_parity_t { UART_PARITY_DISABLE = 0, UART_PARITY_EVEN = 2, UART_PARITY_ODD = 3 };
+enum uart_stop_bits_t { UART_STOP_BITS_1 = 1, UART_STOP_BITS_1_5 = 2, UART_STOP_BITS_2 = 3 };
+enum uart_hw_flowcontrol_t { UART_HW_FLOWCTRL_DISABLE = 0 };
+enum uart_sclk_t { UART_SCLK_APB, UART_SCLK_REF_TICK };
+
+struct uart_config_t
+{
+    int baud_rate;
+    uart_word_length_t data_bits;
+    uart_parity_t parity;
+    uart_stop_bits_t stop_bits;
+    uart_hw_flowcontrol_t flow_ctrl;
+    uint8_t rx_flow_ctrl_thresh;
+    uart_sclk_t source_clk;
+};
+
+enum uart_event_type_t
+{
+    UART_DATA,
+    UART_BREAK,
+    UART_BUFFER_FULL,
+    UART_FIFO_OVF,
+    UART_FRAME_ERR,
+    UART_PARITY_ERR,
+    UART_DATA_BREAK,
+    UART_PATTERN_DET,
+    UART_EVENT_MAX,
+};
+
+struct uart_event_t
+{
+    uart_event_type_t type;
+    size_t size;
+    bool timeout_flag;
+};
+
+// Host only: the tty behind uart_num. Call before uart_driver_install().
+esp_err_t hostUartAttach(uart_port_t uart_num, const char *path);
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+                              QueueHandle_t *uart_queue, int intr_alloc_flags);
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config);
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num);
+esp_err_t uart_set_rx_timeout(uart_port_t uart_num, uint8_t tout_thresh);
+esp_err_t uart_flush_input(uart_port_t uart_num);
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size);
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks_to_wait);
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait);
+
+#endif // HOST_DRIVER_UART_H
@@ -0,0 +1,8 @@
+// FILE: esp_system.h
+//
+// Host shim: included by config.h, not used by the SRNE HAL.
+
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+#endif // HOST_ESP_SYSTEM_H
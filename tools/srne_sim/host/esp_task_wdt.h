@@ -0,0 +1,12 @@
+// FILE: esp_task_wdt.h
+//
+// Host shim: there is no task watchdog on the host.
+
+#ifndef HOST_ESP_TASK_WDT_H
+#define HOST_ESP_TASK_WDT_H
+
+#include "esp_err.h"
+
+esp_err_t esp_task_wdt_reset();
+
+#endif // HOST_ESP_TASK_WDT_H
@@ -0,0 +1,10 @@
+// FILE: esp_timer.h
+
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(); // Microseconds since the program started
+
+#endif // HOST_ESP_TIMER_H
@@ -0,0 +1,590 @@
+// FILE: host_shim.cpp
+//
+// POSIX implementations of the Arduino, FreeRTOS and UART driver calls declared by the headers
+// in this directory. Just enough to run src/hal_srne.cpp unchanged on a Linux host.
+
+#include "Arduino.h"
+#include "boot_trace.h"
+#include "driver/uart.h"
+#include "esp_task_wdt.h"
+#include "esp_timer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <sys/select.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+struct HostTask
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t notified;
+    uint32_t notify_value;
+    bool notify_pending;
+    TaskFunction_t function;
+    void *parameter;
+};
+
+struct HostQueue
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    size_t item_size;
+    size_t length;
+    size_t count;
+    size_t head;
+    uint8_t *items;
+};
+
+struct HostUart
+{
+    int fd;
+    int baud_rate;
+    uint32_t rx_timeout_us;
+    QueueHandle_t events;
+    pthread_mutex_t mutex;
+    pthread_cond_t received;
+    uint8_t *rx;
+    size_t rx_size;
+    size_t rx_used;
+    size_t rx_unreported; // Bytes not yet announced by a UART_DATA event
+};
+
+// --- Module-level (static) variables ---
+static const size_t UART_RX_FULL_THRESHOLD = 120; // The driver's default RX FIFO full interrupt level
+static const uint32_t UART_BITS_PER_BYTE = 10;
+
+HardwareSerial Serial;
+
+static HostUart uarts[UART_NUM_MAX];
+static thread_local HostTask *current_task = NULL;
+static struct timespec start_time;
+static pthread_once_t start_once = PTHREAD_ONCE_INIT;
+
+// --- Private Function Prototypes ---
+static void recordStartTime();
+static int64_t monotonicUs();
+static void initCondition(pthread_cond_t *condition);
+static bool waitTicks(pthread_cond_t *condition, pthread_mutex_t *mutex, const struct timespec *deadline);
+static const struct timespec *deadlineAfter(TickType_t ticks, struct timespec *deadline);
+static HostTask *newTask();
+static void *taskEntry(void *argument);
+static HostUart *uartFor(uart_port_t uart_num);
+static uint32_t wireTimeUs(const HostUart &uart, size_t bytes);
+static void postUartEvent(HostUart &uart, uart_event_type_t type, size_t size, bool timeout_flag);
+static void *uartReader(void *argument);
+
+// --- Arduino ---
+
+int HardwareSerial::printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int written = vprintf(format, args);
+    va_end(args);
+    fflush(stdout);
+    return written;
+}
+
+size_t HardwareSerial::print(const char *text)
+{
+    return printf("%s", text);
+}
+
+size_t HardwareSerial::println(const char *text)
+{
+    return printf("%s\n", text);
+}
+
+// --- ESP-IDF ---
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code)
+    {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+int64_t esp_timer_get_time()
+{
+    pthread_once(&start_once, recordStartTime);
+    return monotonicUs() - ((int64_t)start_time.tv_sec * 1000000 + start_time.tv_nsec / 1000);
+}
+
+esp_err_t esp_task_wdt_reset()
+{
+    return ESP_OK;
+}
+
+void bootTraceMark(const char *phase)
+{
+    (void)phase;
+}
+
+// --- FreeRTOS tasks and notifications ---
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_depth, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t core)
+{
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+    (void)core;
+
+    HostTask *task = newTask();
+    task->function = function;
+    task->parameter = parameter;
+    if (created != NULL) *created = task; // Before the thread runs, as FreeRTOS guarantees
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, taskEntry, task) != 0) return pdFAIL;
+    pthread_detach(thread);
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    if (current_task == NULL) current_task = newTask(); // The main thread, or any foreign thread
+    return current_task;
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return (TickType_t)(esp_timer_get_time() / 1000);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    usleep((useconds_t)ticks * 1000);
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    BaseType_t result = pdPASS;
+    pthread_mutex_lock(&task->mutex);
+    switch (action)
+    {
+        case eNoAction: break;
+        case eSetBits: task->notify_value |= value; break;
+        case eIncrement: task->notify_value++; break;
+        case eSetValueWithOverwrite: task->notify_value = value; break;
+        case eSetValueWithoutOverwrite:
+            if (task->notify_pending)
+            {
+                result = pdFAIL;
+            }
+            else
+            {
+                task->notify_value = value;
+            }
+            break;
+    }
+    task->notify_pending = true;
+    pthread_cond_broadcast(&task->notified);
+    pthread_mutex_unlock(&task->mutex);
+    return result;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    HostTask *task = xTaskGetCurrentTaskHandle();
+    struct timespec deadline;
+    const struct timespec *until = deadlineAfter(ticks, &deadline);
+
+    pthread_mutex_lock(&task->mutex);
+    while (task->notify_value == 0 && waitTicks(&task->notified, &task->mutex, until))
+    {
+    }
+    uint32_t value = task->notify_value;
+    if (value != 0) task->notify_value = clear_on_exit ? 0 : value - 1;
+    task->notify_pending = false;
+    pthread_mutex_unlock(&task->mutex);
+    return value;
+}
+
+// --- FreeRTOS queues and semaphores ---
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    HostQueue *queue = (HostQueue *)calloc(1, sizeof(HostQueue));
+    if (queue == NULL || length == 0) return NULL;
+
+    pthread_mutex_init(&queue->mutex, NULL);
+    initCondition(&queue->changed);
+    queue->item_size = item_size;
+    queue->length = length;
+    queue->items = (uint8_t *)calloc(length, item_size > 0 ? item_size : 1);
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    struct timespec deadline;
+    const struct timespec *until = deadlineAfter(ticks, &deadline);
+
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == queue->length && waitTicks(&queue->changed, &queue->mutex, until))
+    {
+    }
+    bool sent = queue->count < queue->length;
+    if (sent)
+    {
+        size_t slot = (queue->head + queue->count) % queue->length;
+        if (queue->item_size > 0) memcpy(queue->items + slot * queue->item_size, item, queue->item_size);
+        queue->count++;
+        pthread_cond_broadcast(&queue->changed);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return sent ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    struct timespec deadline;
+    const struct timespec *until = deadlineAfter(ticks, &deadline);
+
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->count == 0 && waitTicks(&queue->changed, &queue->mutex, until))
+    {
+    }
+    bool received = queue->count > 0;
+    if (received)
+    {
+        if (queue->item_size > 0) memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        pthread_cond_broadcast(&queue->changed);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return received ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+    queue->count = 0;
+    queue->head = 0;
+    pthread_cond_broadcast(&queue->changed);
+    pthread_mutex_unlock(&queue->mutex);
+    return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer)
+{
+    (void)buffer;
+    return xQueueCreate(1, 0); // Created empty: the first take blocks until a give
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    return xQueueReceive(semaphore, NULL, ticks);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    return xQueueSend(semaphore, NULL, 0);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+    pthread_mutex_destroy(&semaphore->mutex);
+    pthread_cond_destroy(&semaphore->changed);
+    free(semaphore->items);
+    free(semaphore);
+}
+
+// --- UART driver ---
+
+esp_err_t hostUartAttach(uart_port_t uart_num, const char *path)
+{
+    HostUart *uart = uartFor(uart_num);
+    if (uart == NULL) return ESP_ERR_INVALID_ARG;
+
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) return ESP_FAIL;
+    uart->fd = fd;
+    uart->baud_rate = 115200; // Until uart_param_config()
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+                              QueueHandle_t *uart_queue, int intr_alloc_flags)
+{
+    (void)tx_buffer_size;
+    (void)intr_alloc_flags;
+
+    HostUart *uart = uartFor(uart_num);
+    if (uart == NULL || uart->fd <= 0 || rx_buffer_size <= 0) return ESP_ERR_INVALID_STATE;
+
+    pthread_mutex_init(&uart->mutex, NULL);
+    initCondition(&uart->received);
+    uart->rx = (uint8_t *)malloc(rx_buffer_size);
+    uart->rx_size = rx_buffer_size;
+    uart->rx_timeout_us = 10 * wireTimeUs(*uart, 1); // The driver's default of 10 symbols
+    if (queue_size > 0)
+    {
+        uart->events = xQueueCreate(queue_size, sizeof(uart_event_t));
+        if (uart_queue != NULL) *uart_queue = uart->events;
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, uartReader, uart) != 0) return ESP_FAIL;
+    pthread_detach(thread);
+    return ESP_OK;
+}
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config)
+{
+    HostUart *uart = uartFor(uart_num);
+    if (uart == NULL || uart->fd <= 0) return ESP_ERR_INVALID_STATE;
+
+    struct termios tio;
+    if (tcgetattr(uart->fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        cfsetspeed(&tio, uart_config->baud_rate == 9600 ? B9600 : B115200);
+        tcsetattr(uart->fd, TCSANOW, &tio);
+    }
+
+    pthread_mutex_lock(&uart->mutex);
+    uart->baud_rate = uart_config->baud_rate;
+    pthread_mutex_unlock(&uart->mutex);
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num)
+{
+    (void)tx_io_num;
+    (void)rx_io_num;
+    (void)rts_io_num;
+    (void)cts_io_num;
+    return uartFor(uart_num) != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_set_rx_timeout(uart_port_t uart_num, uint8_t tout_thresh)
+{
+    HostUart *uart = uartFor(uart_num);
+    if (uart == NULL) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&uart->mutex);
+    uart->rx_timeout_us = tout_thresh * wireTimeUs(*uart, 1);
+    pthread_mutex_unlock(&uart->mutex);
+    return ESP_OK;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num)
+{
+    HostUart *uart = uartFor(uart_num);
+    if (uart == NULL) return ESP_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&uart->mutex);
+    uart->rx_used = 0;
+    uart->rx_unreported = 0;
+    pthread_mutex_unlock(&uart->mutex);
+    return ESP_OK;
+}
+
+// Returns once the frame is on the wire: the other end sees all of it at the end of its wire
+// time, as it would at 9600 baud, so uart_wait_tx_done() has nothing left to wait for
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size)
+{
+    HostUart *uart = uartFor(uart_num);
+    if (uart == NULL || uart->fd <= 0) return -1;
+
+    usleep(wireTimeUs(*uart, size));
+    const uint8_t *data = (const uint8_t *)src;
+    size_t written = 0;
+    while (written < size)
+    {
+        ssize_t n = write(uart->fd, data + written, size - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        written += n;
+    }
+    return (int)written;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks_to_wait)
+{
+    (void)ticks_to_wait;
+    HostUart *uart = uartFor(uart_num);
+    if (uart == NULL || uart->fd <= 0) return ESP_ERR_INVALID_STATE;
+    return ESP_OK;
+}
+
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    HostUart *uart = uartFor(uart_num);
+    if (uart == NULL || uart->rx == NULL) return -1;
+
+    struct timespec deadline;
+    const struct timespec *until = deadlineAfter(ticks_to_wait, &deadline);
+
+    pthread_mutex_lock(&uart->mutex);
+    while (uart->rx_used < length && waitTicks(&uart->received, &uart->mutex, until))
+    {
+    }
+    size_t n = uart->rx_used < length ? uart->rx_used : length;
+    memcpy(buf, uart->rx, n);
+    memmove(uart->rx, uart->rx + n, uart->rx_used - n);
+    uart->rx_used -= n;
+    pthread_mutex_unlock(&uart->mutex);
+    return (int)n;
+}
+
+// --- Private Function Implementations ---
+
+static void recordStartTime()
+{
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+}
+
+static int64_t monotonicUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void initCondition(pthread_cond_t *condition)
+{
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(condition, &attributes);
+    pthread_condattr_destroy(&attributes);
+}
+
+// NULL deadline: wait forever. Returns false once the deadline has passed.
+static bool waitTicks(pthread_cond_t *condition, pthread_mutex_t *mutex, const struct timespec *deadline)
+{
+    if (deadline == NULL) return pthread_cond_wait(condition, mutex) == 0;
+    return pthread_cond_timedwait(condition, mutex, deadline) != ETIMEDOUT;
+}
+
+static const struct timespec *deadlineAfter(TickType_t ticks, struct timespec *deadline)
+{
+    if (ticks == portMAX_DELAY) return NULL;
+
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    int64_t ns = deadline->tv_nsec + (int64_t)ticks * portTICK_PERIOD_MS * 1000000;
+    deadline->tv_sec += ns / 1000000000;
+    deadline->tv_nsec = ns % 1000000000;
+    return deadline;
+}
+
+static HostTask *newTask()
+{
+    HostTask *task = (HostTask *)calloc(1, sizeof(HostTask));
+    pthread_mutex_init(&task->mutex, NULL);
+    initCondition(&task->notified);
+    return task;
+}
+
+static void *taskEntry(void *argument)
+{
+    current_task = (HostTask *)argument;
+    current_task->function(current_task->parameter);
+    return NULL;
+}
+
+static HostUart *uartFor(uart_port_t uart_num)
+{
+    if (uart_num < 0 || uart_num >= UART_NUM_MAX) return NULL;
+    return &uarts[uart_num];
+}
+
+static uint32_t wireTimeUs(const HostUart &uart, size_t bytes)
+{
+    return (uint32_t)((uint64_t)bytes * UART_BITS_PER_BYTE * 1000000 / uart.baud_rate);
+}
+
+// Dropped when the queue is full, as from the driver's ISR
+static void postUartEvent(HostUart &uart, uart_event_type_t type, size_t size, bool timeout_flag)
+{
+    if (uart.events == NULL) return;
+
+    uart_event_t event = {};
+    event.type = type;
+    event.size = size;
+    event.timeout_flag = timeout_flag;
+    xQueueSend(uart.events, &event, 0);
+}
+
+// Stands in for the RX interrupt. The pty delivers a reply all at once, so each read is held back
+// for its wire time before it reaches the RX buffer.
+static void *uartReader(void *argument)
+{
+    HostUart &uart = *(HostUart *)argument;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&uart.mutex);
+        uint32_t wait_us = uart.rx_unreported > 0 ? uart.rx_timeout_us : 100000;
+        pthread_mutex_unlock(&uart.mutex);
+
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(uart.fd, &fds);
+        struct timeval tv = {(time_t)(wait_us / 1000000), (suseconds_t)(wait_us % 1000000)};
+        int ready = select(uart.fd + 1, &fds, NULL, NULL, &tv);
+        if (ready < 0 && errno != EINTR) break;
+
+        if (ready <= 0)
+        {
+            // Line idle for the RX timeout: report what has arrived
+            pthread_mutex_lock(&uart.mutex);
+            if (uart.rx_unreported > 0)
+            {
+                postUartEvent(uart, UART_DATA, uart.rx_unreported, true);
+                uart.rx_unreported = 0;
+            }
+            pthread_mutex_unlock(&uart.mutex);
+            continue;
+        }
+
+        uint8_t chunk[64];
+        ssize_t n = read(uart.fd, chunk, sizeof(chunk));
+        if (n <= 0)
+        {
+            usleep(10000); // No simulator on the other end yet
+            continue;
+        }
+        usleep(wireTimeUs(uart, n));
+
+        pthread_mutex_lock(&uart.mutex);
+        size_t space = uart.rx_size - uart.rx_used;
+        size_t kept = (size_t)n < space ? (size_t)n : space;
+        memcpy(uart.rx + uart.rx_used, chunk, kept);
+        uart.rx_used += kept;
+        uart.rx_unreported += kept;
+        if (kept < (size_t)n) postUartEvent(uart, UART_BUFFER_FULL, 0, false);
+        if (uart.rx_unreported >= UART_RX_FULL_THRESHOLD)
+        {
+            postUartEvent(uart, UART_DATA, uart.rx_unreported, false);
+            uart.rx_unreported = 0;
+        }
+        pthread_cond_broadcast(&uart.received);
+        pthread_mutex_unlock(&uart.mutex);
+    }
+    return NULL;
+}
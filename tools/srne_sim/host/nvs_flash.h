@@ -0,0 +1,8 @@
+// FILE: nvs_flash.h
+//
+// Host shim: included by config.h, not used by the SRNE HAL.
+
+#ifndef HOST_NVS_FLASH_H
+#define HOST_NVS_FLASH_H
+
+#endif // HOST_NVS_FLASH_H
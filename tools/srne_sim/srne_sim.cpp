@@ -0,0 +1,444 @@
+// FILE: srne_sim.cpp
+//
+// Host-side SRNE charge controller simulator (Modbus RTU slave, address 0x01) on a Linux
+// pseudo-terminal. It serves the registers this firmware uses:
+//   0x0000-0x003F  controller information (0x000A is the HAL's presence probe)
+//   0x0100-0x011F  real-time telemetry and accumulated totals
+//   0xDF00-0xDF1F  commands (0xDF05 clears the totals, 0xDF09-0xDF0B load mode/power/duration)
+//   0xE000-0xE0FF  battery and load settings, including the 0xE092 load schedule block
+// with FC 0x03, 0x06 and 0x10, plus a simple PV/battery/load model so telemetry moves.
+//
+// Build:  g++ -O2 -std=gnu++11 -Iinclude -o srne_sim tools/srne_sim/srne_sim.cpp src/crc_utils.cpp
+// Run:    ./srne_sim --link /tmp/srne --latency 20 --jitter 10
+//
+// The controller side of the link is the pty slave (or the --link symlink). To put real firmware
+// on the bench, bridge it to a USB-RS485 adapter wired to the ESP32's SRNE port:
+//         socat /dev/ttyUSB0,raw,echo=0,b9600 /tmp/srne,raw,echo=0
+//
+// hal_link_test.cpp runs the firmware's own HAL against it on the host instead.
+
+#include "crc_utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// --- Configuration ---
+struct SimConfig
+{
+    const char *link_path;
+    uint32_t latency_ms;   // Turnaround before every reply
+    uint32_t jitter_ms;    // Uniform extra turnaround, 0..jitter_ms
+    uint32_t drop_percent; // Requests left unanswered
+    uint32_t corrupt_percent; // Replies sent with a broken CRC
+    double day_seconds;    // Length of one simulated day
+    double capacity_ah;
+    bool verbose;
+};
+
+static SimConfig config = {NULL, 15, 5, 0, 0, 600.0, 100.0, false};
+
+// --- Module-level (static) variables ---
+static const uint8_t SLAVE_ADDRESS = 0x01;
+static const uint16_t MAX_READ_REGISTERS = 125;
+static const uint16_t MAX_WRITE_REGISTERS = 123;
+static const uint32_t FRAME_GAP_MS = 20; // Drop a partial request after this much silence
+
+static uint16_t registers[0x10000];
+static volatile sig_atomic_t running = 1;
+
+// Model state (SI units)
+static double soc = 0.6;
+static double charge_ah = 0.0;
+static double discharge_ah = 0.0;
+static double charge_wh = 0.0;
+static double load_wh = 0.0;
+static double sim_clock_s = 0.0;
+
+// --- Private Function Prototypes ---
+static void usage(const char *name);
+static bool parseArgs(int argc, char **argv);
+static void handleSignal(int sig);
+static uint64_t nowMs();
+static void initRegisters();
+static bool readable(uint16_t address, uint16_t count);
+static bool writable(uint16_t address, uint16_t count);
+static void onWrite(uint16_t address, uint16_t count);
+static void stepModel(double dt_s);
+static void putU32(uint16_t address, uint32_t value);
+static size_t expectedRequestLength(const uint8_t *frame, size_t length);
+static size_t handleRequest(const uint8_t *request, size_t length, uint8_t *reply);
+static size_t exceptionReply(uint8_t function_code, uint8_t code, uint8_t *reply);
+static void appendCrc(uint8_t *frame, size_t length);
+static void sendReply(int fd, uint8_t *reply, size_t length);
+
+// --- Main ---
+
+int main(int argc, char **argv)
+{
+    if (!parseArgs(argc, argv))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        perror("posix_openpt");
+        return 1;
+    }
+    const char *slave_name = ptsname(master);
+
+    // Hold the slave open in raw mode so the line discipline never echoes or edits frames and the
+    // master does not see a hang-up between client sessions.
+    int slave = open(slave_name, O_RDWR | O_NOCTTY);
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    cfsetspeed(&tio, B9600);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    if (config.link_path != NULL)
+    {
+        unlink(config.link_path);
+        if (symlink(slave_name, config.link_path) != 0)
+        {
+            perror("symlink");
+            return 1;
+        }
+    }
+
+    signal(SIGINT, handleSignal);
+    signal(SIGTERM, handleSignal);
+    srand((unsigned)time(NULL));
+    initRegisters();
+    stepModel(0.0);
+
+    printf("SRNE simulator on %s%s%s (latency %u+%u ms, drop %u%%, corrupt %u%%)\n",
+           slave_name, config.link_path ? " -> " : "", config.link_path ? config.link_path : "",
+           config.latency_ms, config.jitter_ms, config.drop_percent, config.corrupt_percent);
+    fflush(stdout);
+
+    uint8_t frame[256];
+    size_t frame_len = 0;
+    uint64_t last_byte_ms = nowMs();
+    uint64_t last_step_ms = nowMs();
+
+    while (running)
+    {
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(master, &fds);
+        struct timeval tv = {0, 10000};
+        int ready = select(master + 1, &fds, NULL, NULL, &tv);
+        if (ready < 0 && errno != EINTR) break;
+
+        uint64_t now = nowMs();
+        if (now - last_step_ms >= 100)
+        {
+            stepModel((now - last_step_ms) / 1000.0);
+            last_step_ms = now;
+        }
+
+        if (ready <= 0)
+        {
+            if (frame_len > 0 && now - last_byte_ms > FRAME_GAP_MS)
+            {
+                if (config.verbose) printf("  dropped %zu-byte partial frame\n", frame_len);
+                frame_len = 0;
+            }
+            continue;
+        }
+
+        ssize_t n = read(master, frame + frame_len, sizeof(frame) - frame_len);
+        if (n <= 0) continue;
+        frame_len += n;
+        last_byte_ms = now;
+
+        size_t needed;
+        while (frame_len > 0 && (needed = expectedRequestLength(frame, frame_len)) != 0 && frame_len >= needed)
+        {
+            uint8_t reply[256];
+            size_t reply_len = handleRequest(frame, needed, reply);
+            if (reply_len > 0) sendReply(master, reply, reply_len);
+
+            memmove(frame, frame + needed, frame_len - needed);
+            frame_len -= needed;
+        }
+        if (frame_len == sizeof(frame)) frame_len = 0; // Garbage that never forms a frame
+    }
+
+    if (config.link_path != NULL) unlink(config.link_path);
+    close(slave);
+    close(master);
+    return 0;
+}
+
+// --- Private Function Implementations ---
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --link PATH      symlink the pty slave to PATH\n"
+            "  --latency MS     reply turnaround (default %u)\n"
+            "  --jitter MS      extra random turnaround 0..MS (default %u)\n"
+            "  --drop PCT       leave PCT%% of requests unanswered\n"
+            "  --corrupt PCT    send PCT%% of replies with a bad CRC\n"
+            "  --day SECONDS    length of one simulated day (default %.0f)\n"
+            "  --capacity AH    battery capacity (default %.0f)\n"
+            "  --verbose        log every frame\n",
+            name, config.latency_ms, config.jitter_ms, config.day_seconds, config.capacity_ah);
+}
+
+static bool parseArgs(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--verbose") == 0) { config.verbose = true; continue; }
+        if (value == NULL) return false;
+
+        if (strcmp(arg, "--link") == 0) config.link_path = value;
+        else if (strcmp(arg, "--latency") == 0) config.latency_ms = strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--jitter") == 0) config.jitter_ms = strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--drop") == 0) config.drop_percent = strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--corrupt") == 0) config.corrupt_percent = strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--day") == 0) config.day_seconds = strtod(value, NULL);
+        else if (strcmp(arg, "--capacity") == 0) config.capacity_ah = strtod(value, NULL);
+        else return false;
+        i++;
+    }
+    return config.day_seconds > 0 && config.capacity_ah > 0;
+}
+
+static void handleSignal(int sig)
+{
+    (void)sig;
+    running = 0;
+}
+
+static uint64_t nowMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void initRegisters()
+{
+    memset(registers, 0, sizeof(registers));
+
+    // Controller information: 0x000A = rated voltage (high byte, V) | rated current (low byte, A)
+    registers[0x000A] = (12 << 8) | 40;
+    registers[0x000B] = (40 << 8) | 0x00;
+
+    // Battery settings block (0xE001-0xE01F)
+    registers[0xE001] = 1000; // Max charge current, 0.01 A
+    registers[0xE002] = 100;  // Nominal capacity, Ah
+    registers[0xE003] = 12;   // System voltage
+    registers[0xE004] = 0x0B; // Battery type: lithium
+    registers[0xE01F] = 5;    // Light control voltage
+
+    // Load settings block (0xE08D-0xE0AC)
+    registers[0xE08D] = 1000; // Max load current, 0.01 A
+
+    // Load command block (0xDF09-0xDF0B)
+    registers[0xDF09] = 0x0200;
+    registers[0xDF0A] = 100;  // Manual load power, %
+}
+
+static bool readable(uint16_t address, uint16_t count)
+{
+    uint32_t end = (uint32_t)address + count;
+    return (end <= 0x0040) ||
+           (address >= 0x0100 && end <= 0x0120) ||
+           (address >= 0xDF00 && end <= 0xDF20) ||
+           (address >= 0xE000 && end <= 0xE100);
+}
+
+static bool writable(uint16_t address, uint16_t count)
+{
+    uint32_t end = (uint32_t)address + count;
+    return (address >= 0xDF00 && end <= 0xDF20) ||
+           (address >= 0xE000 && end <= 0xE100);
+}
+
+static void onWrite(uint16_t address, uint16_t count)
+{
+    for (uint32_t a = address; a < (uint32_t)address + count; a++)
+    {
+        if (a == 0xDF05 && registers[a] == 1)
+        {
+            charge_ah = discharge_ah = charge_wh = load_wh = 0.0;
+            registers[a] = 0;
+            stepModel(0.0);
+            if (config.verbose) printf("  accumulated totals cleared\n");
+        }
+    }
+}
+
+// One-pole battery model: PV follows a half-sine over the daylight half of the simulated day,
+// the load draws its manual power percentage of 40 W while switched on, and SOC integrates the
+// net current against the configured capacity.
+static void stepModel(double dt_s)
+{
+    sim_clock_s = fmod(sim_clock_s + dt_s, config.day_seconds);
+    double phase = sim_clock_s / config.day_seconds;
+    double irradiance = (phase < 0.5) ? sin(phase * 2.0 * M_PI) : 0.0;
+
+    double battery_voltage = 12.0 + 1.6 * soc;
+    double solar_voltage = (irradiance > 0.02) ? 17.0 + 3.0 * irradiance : 0.5;
+    double max_charge_a = registers[0xE001] / 100.0;
+    double solar_power = 200.0 * irradiance;
+    double charge_a = (soc < 1.0) ? fmin(solar_power / battery_voltage, max_charge_a) : 0.0;
+    double solar_current = (solar_voltage > 1.0) ? charge_a * battery_voltage / solar_voltage : 0.0;
+
+    bool load_on = soc > 0.05 && (registers[0xDF09] & 0xFF00) != 0;
+    double load_power = load_on ? 0.4 * fmin(registers[0xDF0A], 100) : 0.0;
+    double load_a = load_power / battery_voltage;
+
+    double dt_h = dt_s / 3600.0;
+    soc += (charge_a - load_a) * dt_h / config.capacity_ah;
+    if (soc > 1.0) soc = 1.0;
+    if (soc < 0.0) soc = 0.0;
+    charge_ah += charge_a * dt_h;
+    discharge_ah += load_a * dt_h;
+    charge_wh += charge_a * battery_voltage * dt_h;
+    load_wh += load_power * dt_h;
+
+    registers[0x0100] = (uint16_t)lround(soc * 100.0);
+    registers[0x0101] = (uint16_t)lround(battery_voltage * 10.0);
+    registers[0x0102] = (uint16_t)lround(charge_a * 100.0);
+    registers[0x0103] = (uint16_t)((35 << 8) | (uint8_t)(int8_t)25); // Controller 35 C, battery 25 C
+    registers[0x0104] = load_on ? (uint16_t)lround(battery_voltage * 10.0) : 0;
+    registers[0x0105] = (uint16_t)lround(load_a * 100.0);
+    registers[0x0106] = (uint16_t)lround(load_power);
+    registers[0x0107] = (uint16_t)lround(solar_voltage * 10.0);
+    registers[0x0108] = (uint16_t)lround(solar_current * 100.0);
+    registers[0x0109] = (uint16_t)lround(charge_a * battery_voltage);
+    putU32(0x0118, (uint32_t)charge_ah);
+    putU32(0x011A, (uint32_t)discharge_ah);
+    putU32(0x011C, (uint32_t)charge_wh);
+    putU32(0x011E, (uint32_t)load_wh);
+}
+
+static void putU32(uint16_t address, uint32_t value)
+{
+    registers[address] = value >> 16; // High word first, as on the real controller
+    registers[address + 1] = value & 0xFFFF;
+}
+
+// Returns the full length of the request starting at frame[0], or 0 if not enough bytes have
+// arrived to tell yet.
+static size_t expectedRequestLength(const uint8_t *frame, size_t length)
+{
+    if (length < 2) return 0;
+    switch (frame[1])
+    {
+        case 0x03:
+        case 0x06: return 8;
+        case 0x10: return (length < 7) ? 0 : 9 + frame[6];
+        default:   return 8; // Unknown function: consume a typical frame so we resynchronise
+    }
+}
+
+static size_t handleRequest(const uint8_t *request, size_t length, uint8_t *reply)
+{
+    uint16_t crc = crc16Modbus(request, length - 2);
+    if (request[length - 2] != (crc & 0xFF) || request[length - 1] != (crc >> 8))
+    {
+        if (config.verbose) printf("  request with bad CRC ignored\n");
+        return 0;
+    }
+    if (request[0] != SLAVE_ADDRESS) return 0;
+    if ((uint32_t)(rand() % 100) < config.drop_percent)
+    {
+        if (config.verbose) printf("  request dropped\n");
+        return 0;
+    }
+
+    const uint8_t function_code = request[1];
+    const uint16_t address = (request[2] << 8) | request[3];
+    const uint16_t word = (request[4] << 8) | request[5];
+    if (config.verbose) printf("  FC 0x%02X @0x%04X (%u)\n", function_code, address, word);
+
+    switch (function_code)
+    {
+        case 0x03:
+        {
+            if (word == 0 || word > MAX_READ_REGISTERS) return exceptionReply(function_code, 0x03, reply);
+            if (!readable(address, word)) return exceptionReply(function_code, 0x02, reply);
+            reply[0] = SLAVE_ADDRESS;
+            reply[1] = function_code;
+            reply[2] = word * 2;
+            for (uint16_t i = 0; i < word; i++)
+            {
+                reply[3 + i * 2] = registers[address + i] >> 8;
+                reply[4 + i * 2] = registers[address + i] & 0xFF;
+            }
+            appendCrc(reply, 3 + word * 2);
+            return 5 + word * 2;
+        }
+        case 0x06:
+        {
+            if (!writable(address, 1)) return exceptionReply(function_code, 0x02, reply);
+            registers[address] = word;
+            onWrite(address, 1);
+            memcpy(reply, request, 8);
+            return 8;
+        }
+        case 0x10:
+        {
+            if (word == 0 || word > MAX_WRITE_REGISTERS || request[6] != word * 2) return exceptionReply(function_code, 0x03, reply);
+            if (!writable(address, word)) return exceptionReply(function_code, 0x02, reply);
+            for (uint16_t i = 0; i < word; i++)
+            {
+                registers[address + i] = (request[7 + i * 2] << 8) | request[8 + i * 2];
+            }
+            onWrite(address, word);
+            memcpy(reply, request, 6);
+            appendCrc(reply, 6);
+            return 8;
+        }
+        default:
+            return exceptionReply(function_code, 0x01, reply);
+    }
+}
+
+static size_t exceptionReply(uint8_t function_code, uint8_t code, uint8_t *reply)
+{
+    reply[0] = SLAVE_ADDRESS;
+    reply[1] = function_code | 0x80;
+    reply[2] = code;
+    appendCrc(reply, 3);
+    return 5;
+}
+
+static void appendCrc(uint8_t *frame, size_t length)
+{
+    uint16_t crc = crc16Modbus(frame, length);
+    frame[length] = crc & 0xFF;
+    frame[length + 1] = crc >> 8;
+}
+
+static void sendReply(int fd, uint8_t *reply, size_t length)
+{
+    uint32_t delay_ms = config.latency_ms + (config.jitter_ms ? rand() % (config.jitter_ms + 1) : 0);
+    if ((uint32_t)(rand() % 100) < config.corrupt_percent) reply[length - 1] ^= 0x5A;
+
+    usleep(delay_ms * 1000);
+    if (write(fd, reply, length) != (ssize_t)length && config.verbose) printf("  short write\n");
+}